@@ -0,0 +1,189 @@
+#pragma once
+
+#include "CellularAutomaton.h"
+#include "SpinBarrier.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// How the CPU engine computes a generation
+enum class CPUKernel {
+    BitSliced,      // Boolean operations on 64 cells at once
+    Lookup,         // Precomputed tables: 4x4 neighbourhood -> 2x2 centre, or two Margolus blocks at once
+};
+
+/*
+ * CPU engine on bit-packed grids, 64 cells per word. The bit-sliced kernel sums
+ * the eight shifted neighbour planes of a word with a carry-save adder into four
+ * count bits and applies the rule to all 64 cells at once; Margolus rules update
+ * 32 blocks per word pair the same way. The lookup kernel reads the next 2x2 cells
+ * from a 64 KB table indexed by their 4x4 neighbourhood (the second-order XOR is
+ * applied afterwards), which suits cores without wide registers better. Both
+ * produce exactly the same grids as GPUCellularAutomaton for the same rule.
+ *
+ * Batches of Moore generations are run with temporal blocking: the grid is cut
+ * into bands of TILE_ROWS rows, and each band is copied with TILE_GENERATIONS
+ * rows of halo on both sides into a small local grid that is advanced that many
+ * generations, its valid rows shrinking by one per generation from each side.
+ * A band's working set then stays in L1 for the whole batch instead of the grid
+ * streaming through it once per generation. Grids small enough to share L1 with
+ * each other gain nothing from it (the halos cost about a fifth more work), so
+ * by default they are stepped one generation at a time; the constructor can
+ * force either way, e.g. to check the tiled path against single stepping.
+ *
+ * With several threads, each one computes a band of rows of every generation (or
+ * its share of the tiles of every temporal block) straight from the shared grids,
+ * and all of them meet at a spin barrier before the buffers rotate. The calling
+ * thread takes the first band; the others spin briefly for the next call, then
+ * sleep until it comes.
+ *
+ * Moore rules without B0 also track which bands of ACTIVITY_ROWS rows of each
+ * buffer have a live cell. A band whose neighbourhood is dead in the source grid
+ * and which is itself dead in the other grid stays dead, so it is cleared (if it
+ * was not already) instead of computed; zero-padded chunks cost almost nothing.
+ */
+class CPUCellularAutomaton : public CellularAutomaton {
+public:
+    // `threads` computes every generation on that many threads (0 = hardware concurrency),
+    // at most one per core; `temporalBlocking` runs batches of Moore generations by tiles
+    explicit CPUCellularAutomaton(const AutomatonRule &rule = {}, CPUKernel kernel = CPUKernel::BitSliced,
+                                  unsigned int threads = 1, bool temporalBlocking = TILED_BY_DEFAULT);
+
+    ~CPUCellularAutomaton() override;
+
+    void runForward() override;
+
+    void runBackward() override;
+
+    void runForwardBy(int generations) override;
+
+    void runBackwardBy(int generations) override;
+
+    void setGeneration(int generation) override;
+
+    void clearPrevGrid() override;
+
+    void writeCurrGrid(const std::array<int, BUFFER_SIZE> &currGrid) override;
+
+    void writePrevGrid(const std::array<int, BUFFER_SIZE> &prevGrid) override;
+
+    void readCurrGrid(std::array<int, BUFFER_SIZE> &currGrid) override;
+
+    void readPrevGrid(std::array<int, BUFFER_SIZE> &prevGrid) override;
+
+    // Copies both grids right away, so the snapshot is ready on the next poll
+    bool requestSnapshot(int tag) override;
+
+    bool pollSnapshot(PackedGrid &currGrid, PackedGrid &prevGrid, int &tag, bool wait = false) override;
+
+    void beginStats(int generations) override;
+
+    void recordStats() override;
+
+    std::vector<GenerationStats> readStats() const override;
+
+    // What Moore kernels read besides the grids, derived from the rule once
+    struct MooreTables {
+        uint64_t birth[9];                  // Rule masks expanded to whole words, by neighbour count
+        uint64_t survive[9];
+        std::vector<uint8_t> lookup;        // Lookup kernel: 4x4 neighbourhood (row-major, 16 bits) -> 2x2 centre
+    };
+
+    // What Margolus kernels read, for one direction
+    struct BlockTables {
+        BlockTable blocks;
+        std::array<uint8_t, 256> pairs;     // Two side by side blocks: top nibble | bottom nibble << 4
+    };
+
+    // Computes rows [first, last) of out = rule(source) ^ other, on grids of `rows`
+    // rows; one instance per topology, plus one hard-wiring Conway's B3/S23
+    using StepKernel = void (*)(const uint64_t *source, const uint64_t *other, uint64_t *out, int rows,
+                                int first, int last, const MooreTables &tables);
+
+    static constexpr int TILE_ROWS = 32;
+    static constexpr int TILE_GENERATIONS = 8;
+    static constexpr size_t L1_BYTES = 32 * 1024;
+    static constexpr bool TILED_BY_DEFAULT = 3 * sizeof(PackedGrid) > L1_BYTES;
+
+    static constexpr int ACTIVITY_ROWS = SIDE / 32;    // One bit of a uint32_t per band
+    static constexpr int MIN_BAND_ROWS = 16;            // A multiple of ACTIVITY_ROWS
+    static constexpr int WORKER_SPINS = 10000;
+
+    // Applies a Margolus table in place to the blocks of one partition whose top
+    // rows are in [first, last) (phase 0: blocks start at even rows and columns,
+    // phase 1: at odd ones); `first` is even
+    using BlockKernel = void (*)(PackedGrid &grid, const BlockTables &tables, int phase, int first, int last);
+
+private:
+    // Local grids of a band being advanced: previous, current, next
+    static constexpr int TILE_WORDS = (TILE_ROWS + 2 * TILE_GENERATIONS) * (SIDE / 64);
+    using Tile = std::array<uint64_t, TILE_WORDS>;
+
+    // What one thread computes: rows [first, last) of every generation, and every
+    // `threads`-th band of a temporal block starting from band `index`
+    struct Band {
+        int index = 0;
+        int first = 0;
+        int last = SIDE;
+        Tile tiles[3]{};
+    };
+
+    // Runs the generations on all threads, returning once they are all done
+    void run(int generations, bool backward);
+
+    // One thread's share of run(); the first band also commits the new buffer order
+    void runBand(Band &band, int generations, bool backward);
+
+    // Computes the band's rows of out = rule(source) ^ other, skipping dead neighbourhoods
+    void stepBand(Band &band, int source, int other, int out);
+
+    // Advances (prev, current) by TILE_GENERATIONS into (spare, next), for the band's tiles
+    void runTiles(Band &band, int prev, int current, int spare, int next);
+
+    // Bit b set when rows [b * ACTIVITY_ROWS, (b + 1) * ACTIVITY_ROWS) of the grid have a live cell
+    static uint32_t liveBands(const PackedGrid &grid);
+
+    void workerLoop(Band &band);
+
+    PackedGrid m_grids[4]{};
+    int m_prev = 0;
+    int m_current = 1;
+    int m_next = 2;
+    int m_spare = 3;
+
+    MooreTables m_rule{};
+    StepKernel m_kernel = nullptr;
+    bool m_toroidal = false;
+    bool m_tiled = false;
+
+    // Live bands of each buffer; every thread updates its own bits
+    bool m_trackActivity = false;
+    std::atomic<uint32_t> m_live[4]{};
+
+    BlockTables m_forwardBlocks{};
+    BlockTables m_backwardBlocks{};
+    BlockKernel m_blockKernel = nullptr;
+    int m_generation = 0;
+
+    PackedGrid m_snapshotCurr{};
+    PackedGrid m_snapshotPrev{};
+    int m_snapshotTag = 0;
+    bool m_snapshotReady = false;
+
+    std::vector<GenerationStats> m_stats;
+    size_t m_statsCapacity = 0;
+
+    // Threads: the calling thread runs m_bands[0], each worker one of the others
+    std::vector<std::unique_ptr<Band>> m_bands;
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<SpinBarrier> m_barrier;
+
+    // Current call, published by bumping m_epoch
+    int m_jobGenerations = 0;
+    bool m_jobBackward = false;
+    bool m_stopping = false;
+    std::atomic<unsigned> m_epoch{0};
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+};
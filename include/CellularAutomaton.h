@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr int SIDE = 256;
+constexpr int BUFFER_SIZE = SIDE * SIDE;
+constexpr int GRID_WORDS = BUFFER_SIZE / 64;
+
+// Bit-packed grid: cell i is bit (i % 64) of word i / 64
+using PackedGrid = std::array<uint64_t, GRID_WORDS>;
+
+// Population of a generation and its Hamming distance to the previous one
+struct GenerationStats {
+    uint32_t live = 0;
+    uint32_t changed = 0;
+};
+
+// What lies beyond the grid edges
+enum class Topology : uint8_t {
+    DeadBorder = 0,     // Cells outside the grid are always dead
+    Toroidal = 1,       // Opposite edges are neighbours
+};
+
+// How a cell's next state is found
+enum class Neighbourhood : uint8_t {
+    Moore = 0,          // Outer totalistic rule on the 8 neighbours, made reversible by the second-order construction
+    Margolus = 1,       // Reversible rule on 2x2 blocks, whose partition shifts by one cell every generation
+};
+
+// Block cell bits used by Margolus tables: 1 = top left, 2 = top right, 4 = bottom left, 8 = bottom right
+using BlockTable = std::array<uint8_t, 16>;
+
+/*
+ * Automaton rule.
+ *
+ * Moore rules use B/S notation: bit n of `birth` (resp. `survive`) is set when a dead
+ * (resp. live) cell with n live neighbours is alive in the next generation. Any rule
+ * works both ways, since the second-order construction makes it reversible, at the
+ * cost of storing two grids per chunk.
+ *
+ * Margolus rules ("critters", "tron") are reversible by themselves: a bijective table
+ * maps every 2x2 block, so only one grid is stored per chunk.
+ */
+struct AutomatonRule {
+    Neighbourhood neighbourhood = Neighbourhood::Moore;
+    uint16_t birth = 1 << 3;                    // B3
+    uint16_t survive = (1 << 2) | (1 << 3);     // S23
+    uint16_t blockRule = 0;                     // Margolus rules: index of the named rule
+    Topology topology = Topology::DeadBorder;
+
+    // Parses "B3/S23" style notation or a Margolus rule name, throws std::invalid_argument otherwise
+    static AutomatonRule parse(const std::string &notation, Topology topology = Topology::DeadBorder);
+
+    // Margolus rule with the given index, throws std::invalid_argument if there is none
+    static AutomatonRule margolus(int blockRule, Topology topology = Topology::DeadBorder);
+
+    // Whether the previous grid is part of the state (and must be stored)
+    bool secondOrder() const { return neighbourhood == Neighbourhood::Moore; }
+
+    // Margolus rules: the table applied going forward, and its inverse
+    BlockTable blockTable() const;
+
+    BlockTable inverseBlockTable() const;
+
+    // Parses "dead" or "torus", throws std::invalid_argument otherwise
+    static Topology parseTopology(const std::string &name);
+
+    // The rule in B/S notation, or the Margolus rule name
+    std::string notation() const;
+
+    // The topology as accepted by parseTopology
+    std::string topologyName() const;
+};
+
+/*
+ * Reversible automaton over a pair of grids (previous, current). With Moore rules,
+ * running forward computes next = rule(current) ^ previous and shifts the pair;
+ * with Margolus rules the next grid depends on the current one only, and the
+ * previous grid merely keeps the last generation (for statistics and display).
+ * Running backward undoes one forward step exactly.
+ */
+class CellularAutomaton {
+public:
+    virtual ~CellularAutomaton() = default;
+
+    virtual void runForward() = 0;
+
+    virtual void runBackward() = 0;
+
+    // Runs several generations at once, which engines may fuse when nothing
+    // needs to see the generations in between
+    virtual void runForwardBy(int generations) {
+        for (int i = 0; i < generations; i++) {
+            runForward();
+        }
+    }
+
+    virtual void runBackwardBy(int generations) {
+        for (int i = 0; i < generations; i++) {
+            runBackward();
+        }
+    }
+
+    // Sets the generation the grids are at; Margolus rules alternate their block
+    // partition with its parity. Moore rules ignore it
+    virtual void setGeneration(int generation) {}
+
+    virtual void clearPrevGrid() = 0;
+
+    virtual void writeCurrGrid(const std::array<int, BUFFER_SIZE> &currGrid) = 0;
+
+    virtual void writePrevGrid(const std::array<int, BUFFER_SIZE> &prevGrid) = 0;
+
+    virtual void readCurrGrid(std::array<int, BUFFER_SIZE> &currGrid) = 0;
+
+    virtual void readPrevGrid(std::array<int, BUFFER_SIZE> &prevGrid) = 0;
+
+    // Queues a copy of both grids for pollSnapshot; returns false (sample skipped)
+    // if the engine has no room for another copy in flight
+    virtual bool requestSnapshot(int tag) = 0;
+
+    // Returns the newest requested snapshot that is ready, bit-packed, and the tag it
+    // was requested with; false if none is ready yet. Never waits unless `wait` is set,
+    // in which case every requested copy is waited for
+    virtual bool pollSnapshot(PackedGrid &currGrid, PackedGrid &prevGrid, int &tag, bool wait = false) = 0;
+
+    // Starts collecting statistics for up to `generations` calls to recordStats
+    virtual void beginStats(int generations) = 0;
+
+    // Records the current generation's statistics
+    virtual void recordStats() = 0;
+
+    // Returns the statistics recorded since beginStats, one entry per recordStats call
+    virtual std::vector<GenerationStats> readStats() const = 0;
+};
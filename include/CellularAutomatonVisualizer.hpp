@@ -5,11 +5,12 @@
 #include <vector>
 #include <array>
 #include <thread>
-#include <mutex>
 #include <atomic>
-#include <condition_variable>
-#include <GPUCellularAutomaton.h>
-#include <queue>
+#include <CellularAutomaton.h>
+#include "SnapshotChannel.h"
+#include "TraceFile.h"
+
+struct Texture; // raylib texture handle
 
 class CellularAutomatonVisualizer {
 public:
@@ -27,7 +28,7 @@ public:
     // Stop the visualizer thread
     void stop();
 
-    // Add a new grid state to visualize (thread-safe)
+    // Publish a new grid state to visualize; never blocks, called from one thread only
     void updateGridState(
         const std::array<int, BUFFER_SIZE> &currentGrid,
         const std::array<int, BUFFER_SIZE> &prevGrid,
@@ -37,6 +38,20 @@ public:
         int totalIterations
     );
 
+    // Same, for grids that are already bit-packed
+    void updateGridState(
+        const PackedGrid &currentGrid,
+        const PackedGrid &prevGrid,
+        int chunkIndex,
+        int totalChunks,
+        int iteration,
+        int totalIterations
+    );
+
+    // Play a recorded trace in the window at the given frame rate, then keep the
+    // last frame on screen until the window is closed
+    void replay(TraceReader &trace, int framesPerSecond = 60);
+
     // Check if visualizer is running
     bool isRunning() const;
 
@@ -44,24 +59,17 @@ public:
     void setSpeed(int delayMs);
 
 private:
-    // Structure to hold grid state information
-    struct GridState {
-        std::array<int, BUFFER_SIZE> currentGrid;
-        std::array<int, BUFFER_SIZE> prevGrid;
-        int chunkIndex;
-        int totalChunks;
-        int iteration;
-        int totalIterations;
-    };
-
     // Thread function that runs the visualization
     void visualizerThread();
 
-    // Draw a single grid to the screen
-    void drawGrid(const std::array<int, BUFFER_SIZE> &grid, int x, int y, int width, int height);
+    // Upload a grid to the single-channel grid texture (live cells black)
+    void uploadGrid(const Texture &texture, const PackedGrid &grid);
+
+    // Draw the grid texture to the screen as one textured quad
+    void drawGrid(const Texture &texture, int x, int y, int width, int height);
 
     // Draw status information
-    void drawStatus(const GridState &state);
+    void drawStatus(const GridSnapshot &state);
 
     // Window properties
     std::string m_title;
@@ -70,13 +78,12 @@ private:
 
     // Thread synchronization
     std::thread m_thread;
-    std::mutex m_mutex;
-    std::condition_variable m_cv;
-    std::queue<GridState> m_stateQueue;
+    SnapshotChannel m_channel;
     std::atomic<bool> m_running;
     std::atomic<int> m_speed; // Delay in milliseconds
 
     // Visualization state
+    std::vector<uint8_t> m_pixels; // Staging pixels for the grid texture
     std::atomic<bool> m_paused;
     std::atomic<int> m_displayMode; // 0=current, 1=prev, 2=both
 };
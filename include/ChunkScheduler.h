@@ -0,0 +1,100 @@
+#pragma once
+
+#include "CellularAutomaton.h"
+#include "EGLManager.h"
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Runs independent chunks on GPU engines and on CPU engines at once. The chunk
+ * indices left form a deque shared by all backends: GPU streams take batches from
+ * the front, and each CPU worker thread runs a single-threaded CPU engine on chunks
+ * taken one at a time from the back, so the two sides only contend for the last
+ * chunks. The calling thread drives the first GPU stream on the main EGL context;
+ * further streams run on their own threads, each with a context from a pool and
+ * its own GPU engine, so their submissions overlap on the device.
+ *
+ * Every backend's throughput is measured online, in generations per second since
+ * chunks (of different files, say) may run different numbers of generations. A
+ * GPU batch is the stream's share of the generations left, capped to BATCH_SECONDS
+ * of its work so the estimate keeps up; a backend stops taking chunks once the
+ * others would finish all of them before it finishes one more. Jobs shorter than
+ * SMALL_JOB_GENERATIONS never start the GPU engines, whose shader compilation and
+ * first dispatch would cost more than the job, and run on the CPU workers only;
+ * so do all jobs when EGL finds no usable display.
+ */
+class ChunkScheduler {
+public:
+    // Runs one chunk on an engine, from writing its grids to reading the result back;
+    // called concurrently for different chunks
+    using ChunkJob = std::function<void(CellularAutomaton &engine, size_t chunk)>;
+
+    // `cpuWorkers` CPU engines (0 = one per core but the calling thread's) run beside
+    // `gpuStreams` GPU engines, which need EGLManager::init() on the calling thread
+    explicit ChunkScheduler(const AutomatonRule &rule, unsigned int cpuWorkers = 0, unsigned int gpuStreams = 1);
+
+    // Runs chunks [0, generations.size()), chunk c running generations[c] generations,
+    // and returns once all are done; rethrows the first exception a job threw, after
+    // the other backends stopped
+    void run(const std::vector<long long> &generations, const ChunkJob &job);
+
+    // Runs chunks [0, count) of `generations` generations each
+    void run(size_t count, long long generations, const ChunkJob &job);
+
+    // Chunks run on each side by the last call
+    size_t gpuChunks() const { return m_gpuChunks; }
+
+    size_t cpuChunks() const { return m_cpuChunks; }
+
+    static constexpr double BATCH_SECONDS = 0.25;
+    static constexpr long long SMALL_JOB_GENERATIONS = 1 << 16;     // About a second of one core
+    static constexpr double RATE_SMOOTHING = 0.5;                   // Weight of the newest measurement
+
+private:
+    // Backend s < m_gpuStreams is GPU stream s, backend m_gpuStreams + w the CPU worker w
+    struct Backend {
+        bool active = false;
+        double rate = 0;        // Generations per second, 0 until measured
+    };
+
+    // Takes the next chunks for a backend: a batch from the front for GPU streams, one
+    // chunk from the back for CPU workers. Returns how many and sets `first`; 0 when it should stop
+    size_t claim(size_t backend, size_t &first);
+
+    // Generations of chunks [first, last)
+    long long generationsOf(size_t first, size_t last) const { return m_prefix[last] - m_prefix[first]; }
+
+    // Folds the time a backend took for chunks [first, first + chunks) into its rate
+    void measured(size_t backend, size_t first, size_t chunks, double seconds);
+
+    // Records the first error and leaves no chunks to the other backends
+    void fail(std::exception_ptr error);
+
+    // Stream 0 runs on the calling thread, the others make their pool context current
+    void runGPU(size_t stream, const ChunkJob &job);
+
+    void runCPU(size_t worker, const ChunkJob &job);
+
+    AutomatonRule m_rule;
+    size_t m_gpuStreams = 1;
+    bool m_gpuUnavailable = false;
+
+    // Created on first use; contexts share objects, so the engines may be destroyed
+    // from the calling thread, before the pool
+    std::unique_ptr<EGLContextPool> m_pool;
+    std::vector<std::unique_ptr<CellularAutomaton>> m_gpu;
+    std::vector<std::unique_ptr<CellularAutomaton>> m_cpu;
+
+    // Current call
+    std::mutex m_mutex;
+    std::vector<Backend> m_backends;
+    size_t m_front = 0;
+    size_t m_back = 0;
+    std::vector<long long> m_prefix;    // Generations of the chunks before each one
+    std::exception_ptr m_error;
+    size_t m_gpuChunks = 0;
+    size_t m_cpuChunks = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Local encode/decode service over a Unix domain socket, so programs encoding many
+ * files pay for EGL, the compute programs and the worker threads once instead of
+ * once per process. Clients connect a SOCK_SEQPACKET socket and send one request
+ * per message, with the input and output files attached as descriptors
+ * (SCM_RIGHTS): the server never opens paths on a client's behalf, so clients
+ * need not share its view of the filesystem and only grant it the two files. Each
+ * request is answered by one reply, in the order the client sent them.
+ *
+ * A thread receives requests into one queue per client; the thread calling
+ * serve() runs them in rounds, taking the oldest request of each client in turn,
+ * so a client queueing many files delays the others by one file at most. Each
+ * queued request holds two descriptors: a client's socket is no longer read once
+ * CLIENT_JOBS of its requests wait, so the server's descriptor table stays bounded
+ * by the clients rather than by what they send.
+ */
+enum class ServiceOperation : uint32_t {
+    Encode = 1,
+    Decode = 2,
+};
+
+struct ServiceRequest {
+    uint32_t magic = 0;                 // SERVICE_MAGIC
+    ServiceOperation operation = ServiceOperation::Encode;
+    char rule[32] = {};                 // Encoding: rule notation, as for --rule
+    char topology[16] = {};             // Encoding: as for --topology
+    char key[48] = {};                  // Decoding
+};
+
+struct ServiceReply {
+    uint32_t magic = 0;                 // SERVICE_MAGIC
+    int32_t status = 0;                 // 0 on success
+    char key[48] = {};                  // Encoding: the key the file was encrypted with
+    char message[256] = {};             // Error message when status is not 0
+};
+
+constexpr uint32_t SERVICE_MAGIC = 0x31534e44; // "DNS1"
+
+// A request the server received, with the client's files; closes them when destroyed
+struct ServiceJob {
+    ServiceRequest request;
+    ServiceReply reply;
+    int input = -1;
+    int output = -1;
+
+    ServiceJob() = default;
+
+    ~ServiceJob();
+
+    ServiceJob(const ServiceJob &) = delete;
+
+    ServiceJob &operator=(const ServiceJob &) = delete;
+
+    // Reads the input file from its current offset to its end, throws std::runtime_error on failure
+    std::vector<uint8_t> readInput() const;
+
+    // Writes all of `data` to the output file, throws std::runtime_error on failure
+    void writeOutput(const std::vector<uint8_t> &data) const;
+
+    // Marks the job failed with `message`
+    void fail(const std::string &message);
+};
+
+class DenisServer {
+public:
+    // Runs one round of jobs, filling in their replies and skipping those already
+    // failed (reply.status not 0); called on the thread calling serve()
+    using RoundRunner = std::function<void(const std::vector<ServiceJob *> &jobs)>;
+
+    // Listens on `path` (replacing a socket left by a previous server), throws std::runtime_error on failure
+    explicit DenisServer(const std::string &path);
+
+    ~DenisServer();
+
+    DenisServer(const DenisServer &) = delete;
+
+    DenisServer &operator=(const DenisServer &) = delete;
+
+    // Receives requests and runs them in rounds of at most ROUND_JOBS until stop()
+    void serve(const RoundRunner &run);
+
+    // Makes serve() return after its current round; async-signal-safe
+    void stop();
+
+    static constexpr size_t ROUND_JOBS = 64;
+    static constexpr size_t CLIENT_JOBS = 16;   // Requests queued per client before its socket is no longer read
+
+private:
+    struct Client;
+
+    // Accepts clients and queues their requests, until stop()
+    void receive();
+
+    // Wakes receive() to poll again, after stop() or once a full queue has room
+    void wake();
+
+    // Queues one request from a client, malformed ones already failed; false once it hung up
+    bool receiveRequest(const std::shared_ptr<Client> &client);
+
+    std::string m_path;
+    int m_socket = -1;
+    int m_wakeup[2] = {-1, -1};         // wake() writes to [1]
+    std::atomic<bool> m_stopping{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::vector<std::shared_ptr<Client>> m_clients;
+    size_t m_turn = 0;                  // Client the next round starts with
+};
+
+class DenisClient {
+public:
+    // Connects to a server's socket, throws std::runtime_error on failure
+    explicit DenisClient(const std::string &path);
+
+    ~DenisClient();
+
+    DenisClient(const DenisClient &) = delete;
+
+    DenisClient &operator=(const DenisClient &) = delete;
+
+    // Sends a request with its input and output files and waits for the reply;
+    // throws std::runtime_error when the server cannot be reached
+    ServiceReply submit(ServiceRequest request, int input, int output);
+
+private:
+    int m_socket = -1;
+};
@@ -1,10 +1,51 @@
 #pragma once
 
+#include <vector>
+
 class EGLManager {
 public:
     EGLManager() = default;
 
+    // Creates the main context on the first hardware device EGL_EXT_device_enumeration
+    // lists (software ones such as llvmpipe otherwise, or the default display without
+    // the extension) and makes it current on the calling thread. Does nothing once the
+    // context exists, so GPU engines call it when created and nothing else pays for
+    // EGL; throws std::runtime_error if there is no usable display
     static void init();
 
+    // Destroys the main context, if init() created it
     static void cleanup();
 };
+
+/*
+ * Contexts for worker threads, on the main context's device and sharing its objects,
+ * so GPU engines created by a worker can be destroyed from any context. Each worker
+ * makes its own context current while it submits work: the driver then receives
+ * several command streams at once instead of one serialised through the main context.
+ */
+class EGLContextPool {
+public:
+    // Creates `contexts` contexts (and the main one if needed), throws std::runtime_error if EGL cannot
+    explicit EGLContextPool(int contexts);
+
+    ~EGLContextPool();
+
+    EGLContextPool(const EGLContextPool &) = delete;
+
+    EGLContextPool &operator=(const EGLContextPool &) = delete;
+
+    int size() const { return static_cast<int>(m_contexts.size()); }
+
+    // Makes context `index` current on the calling thread; a context is current on
+    // at most one thread at a time
+    void makeCurrent(int index);
+
+    // Leaves the calling thread without a current context
+    static void release();
+
+private:
+    void destroy();
+
+    std::vector<void *> m_contexts;
+    std::vector<void *> m_surfaces;     // Only without EGL_KHR_surfaceless_context
+};
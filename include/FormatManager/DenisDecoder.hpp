@@ -18,12 +18,13 @@ struct DenisHeader {
     int data_size;
     int padding;
     std::vector<byte> extra;
+    DenisAutomaton automaton;
 };
 
 
 class DenisDecoder {
 
-    std::set<int> SUPPORTED_VERSIONS = {1, 2};
+    std::set<int> SUPPORTED_VERSIONS = {1, 2, 3};
 
 public:
     
@@ -32,11 +33,13 @@ public:
 
     [[nodiscard]] int GetVersion();
     std::pair<DenisHeader, std::vector<byte>> Decode(std::string &fp);
+    std::pair<DenisHeader, std::vector<byte>> Decode(const std::vector<byte> &buffer);
 
 private:
     
     [[nodiscard]] static DenisHeader ReadVersion1Header(std::vector<byte> &buffer);
     [[nodiscard]] static DenisHeader ReadVersion2Header(std::vector<byte> &buffer);
+    [[nodiscard]] static DenisHeader ReadVersion3Header(std::vector<byte> &buffer);
     
     [[nodiscard]] DenisHeader ReadHeader(std::vector<byte> &buffer);
 
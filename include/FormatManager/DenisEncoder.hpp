@@ -13,7 +13,7 @@
 
 class DenisEncoder {
 
-    std::set<int> SUPPORTED_VERSIONS = {1, 2};
+    std::set<int> SUPPORTED_VERSIONS = {1, 2, 3};
 
 public:
     
@@ -22,14 +22,19 @@ public:
 
     [[nodiscard]] int GetVersion();
     void Encode(std::string &fp, std::vector<byte> &data, DenisExtensionType type, int padding = 0);
+    [[nodiscard]] std::vector<byte> EncodeToBuffer(std::vector<byte> &data, DenisExtensionType type, int padding = 0);
+    void SetAutomaton(const DenisAutomaton &automaton);
 
 private:
     
     [[nodiscard]] static std::vector<byte> GetVersion1Header(std::vector<byte> &data, DenisExtensionType type);
     [[nodiscard]] static std::vector<byte> GetVersion2Header(std::vector<byte> &data, DenisExtensionType type, int padding);
+    [[nodiscard]] static std::vector<byte> GetVersion3Header(std::vector<byte> &data, DenisExtensionType type, int padding,
+                                                             const DenisAutomaton &automaton);
     [[nodiscard]] std::vector<byte> GetHeader(std::vector<byte> &data, DenisExtensionType type, int padding);
 
     int version_;
+    DenisAutomaton automaton_;
     
 };
 
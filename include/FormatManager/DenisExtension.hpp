@@ -31,6 +31,18 @@ const std::unordered_map<std::string, DenisExtensionType> EXTENSION_MAP_REVERSE
 };
 
 
+// Automaton a file was encoded with, stored from version 3 on. Older files were
+// always encoded with B3/S23 and a dead border
+struct DenisAutomaton {
+    int birth = 0x008;      // Bit n set: dead cells with n live neighbours are born (Margolus: rule index)
+    int survive = 0x00C;    // Bit n set: live cells with n live neighbours survive (Margolus: 0)
+    int flags = 0;          // DENIS_FLAG_* bits
+};
+
+const int DENIS_FLAG_TOROIDAL = 0x01;
+const int DENIS_FLAG_MARGOLUS = 0x02;   // Block rule: one grid per chunk instead of two
+
+
 const int HEADER_LENGTH = 24;
 const std::string DENIS_MAGIC_STRING = "DENIS";
 const std::vector<byte> DENIS_TERMINATOR = std::vector<byte>(8, 0xFF);
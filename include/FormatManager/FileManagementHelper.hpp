@@ -7,6 +7,12 @@
 #include <stdexcept>
 #include <filesystem>
 #include <fstream>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // Use standard uint8_t instead of custom byte type
 using byte = uint8_t;
@@ -77,6 +83,36 @@ public:
         return buffer;
     }
 
+    /**
+     * Creates a file only its owner may access, for keys and whatever gives them away.
+     * An existing file is replaced rather than truncated, so descriptors opened on it
+     * earlier never see the new content; a symbolic link is not followed
+     *
+     * @param fp Path to the output file
+     * @return Stream writing to the file, for the caller to fclose
+     */
+    static FILE *CreatePrivate(const std::string &fp) {
+        if (unlink(fp.c_str()) != 0 && errno != ENOENT)
+            throw std::runtime_error("[e] Error replacing file: " + fp + ": " + std::strerror(errno));
+        int fd = open(fp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW, 0600);
+        if (fd < 0)
+            throw std::runtime_error("[e] Error opening file for writing: " + fp + ": " + std::strerror(errno));
+        // The mode is only a request on filesystems that keep their own (e.g. mounted with uid/umask)
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || ((st.st_mode & 077) != 0 && fchmod(fd, 0600) != 0)) {
+            int error = errno;
+            close(fd);
+            unlink(fp.c_str());
+            throw std::runtime_error("[e] Error restricting file to its owner: " + fp + ": " + std::strerror(error));
+        }
+        FILE *file = fdopen(fd, "wb");
+        if (!file) {
+            close(fd);
+            throw std::runtime_error("[e] Error opening file for writing: " + fp);
+        }
+        return file;
+    }
+
     /**
      * Converts a string to a byte vector
      * 
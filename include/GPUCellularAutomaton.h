@@ -1,39 +1,102 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <optional>
+#include <vector>
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include "CellularAutomaton.h"
 
-constexpr int SIDE = 256;
-constexpr int BUFFER_SIZE = SIDE * SIDE;
-
-class GPUCellularAutomaton {
+class GPUCellularAutomaton : public CellularAutomaton {
 public:
-    GPUCellularAutomaton();
+    // Compiles the shaders specialised for the rule and topology, creating the main EGL
+    // context on the calling thread first if there is none; throws std::runtime_error without one
+    explicit GPUCellularAutomaton(const AutomatonRule &rule = {});
+
+    ~GPUCellularAutomaton() override;
+
+    void runForward() override;
+
+    void runBackward() override;
 
-    ~GPUCellularAutomaton();
+    void setGeneration(int generation) override;
 
-    void runForward();
+    void clearPrevGrid() override;
 
-    void runBackward();
+    void writeCurrGrid(const std::array<GLint, BUFFER_SIZE> &currGrid) override;
 
-    void clearPrevGrid() const;
+    void writePrevGrid(const std::array<GLint, BUFFER_SIZE> &prevGrid) override;
 
-    void writeCurrGrid(std::array<GLint, BUFFER_SIZE> &currGrid) const;
+    void readCurrGrid(std::array<GLint, BUFFER_SIZE> &currGrid) override;
 
-    void writePrevGrid(std::array<GLint, BUFFER_SIZE> &prevGrid) const;
+    void readPrevGrid(std::array<GLint, BUFFER_SIZE> &prevGrid) override;
 
-    void readCurrGrid(std::array<GLint, BUFFER_SIZE> &currGrid) const;
+    // Queues a copy of both grids into a staging buffer behind a fence, without
+    // waiting for the GPU; returns false (sample skipped) if every staging buffer
+    // is still in flight
+    bool requestSnapshot(int tag) override;
 
-    void readPrevGrid(std::array<GLint, BUFFER_SIZE> &prevGrid) const;
+    bool pollSnapshot(PackedGrid &currGrid, PackedGrid &prevGrid, int &tag, bool wait = false) override;
+
+    void beginStats(int generations) override;
+
+    // Queues a reduction of the current generation's statistics on the GPU, without reading them back
+    void recordStats() override;
+
+    std::vector<GenerationStats> readStats() const override;
 
 private:
+    static constexpr int STAGING_BUFFERS = 3;
+
+    // Margolus step: next = table(current) on the given partition, then shift the buffers
+    void runBlocks(unsigned int program, int phase);
+
+    // Moore step with the given program: next = rule(source) ^ other, over the
+    // tiles that may be live when tracking activity
+    void runMoore(unsigned int program, int source, int other);
+
+    // Sets the tile flags of a buffer from its cells (null: all dead)
+    void writeActivity(int buffer, const GLint *cells);
+
+    struct StagingBuffer {
+        unsigned int buffer = 0;
+        GLsync fence = nullptr;
+        int tag = 0;
+    };
+
     unsigned int m_buffers[3];
     unsigned int m_forward_shader_program = 0;
     unsigned int m_backward_shader_program = 0;
+    unsigned int m_stats_shader_program = 0;
 
     int m_prev_buffer = 0;
     int m_current_buffer = 1;
     int m_next_buffer = 2;
+
+    // Margolus rules: the partition alternates with the generation's parity
+    bool m_block_rule = false;
+    int m_generation = 0;
+
+    // Moore rules without B0 skip the tiles whose neighbourhood is dead: the three
+    // buffers have a flag per 16x16 tile, live when equal to the buffer's stamp, and
+    // a pre-pass lists the tiles to compute for an indirect dispatch. A wrapped stamp
+    // matching a stale flag only makes a dead tile computed
+    static constexpr int TILES = (SIDE / 16) * (SIDE / 16);
+    bool m_track_activity = false;
+    unsigned int m_activity_shader_program = 0;
+    unsigned int m_activity_buffer = 0;
+    unsigned int m_active_tiles_buffer = 0;
+    GLuint m_activity_stamps[3] = {0, 0, 0};
+    GLuint m_next_stamp = 1;
+
+    // Ring of fenced readback buffers, oldest request at m_staging_tail
+    StagingBuffer m_staging[STAGING_BUFFERS];
+    int m_staging_head = 0;
+    int m_staging_tail = 0;
+
+    // Statistics slots filled by the reduction shader, two counters per generation
+    unsigned int m_stats_buffer = 0;
+    int m_stats_capacity = 0;
+    int m_stats_count = 0;
 };
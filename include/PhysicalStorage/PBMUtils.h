@@ -9,19 +9,83 @@ namespace PhysicalStorage {
     public:
         /**
          * Parses a PBM file into a bit matrix.
+         * Both ASCII (P1) and binary (P4) files are supported; binary files are
+         * memory-mapped and their rows unpacked with SIMD.
          *
          * @param filename Path to the PBM file
          * @param width Output parameter to store the matrix width
          * @param height Output parameter to store the matrix height
-         * @return Vector containing the parsed bit data
+         * @return Vector containing the parsed bit data (one byte per pixel, 1 = black)
          */
         static std::vector<uint8_t> parsePBMFile(
             const std::string &filename,
             int &width,
-            int &height);    
+            int &height);
+
+        /**
+         * Parses a PBM file into a bit-packed matrix.
+         * Rows are packed MSB first and padded to a whole byte, as in P4 files.
+         *
+         * @param filename Path to the PBM file
+         * @param width Output parameter to store the matrix width
+         * @param height Output parameter to store the matrix height
+         * @return Vector containing the packed rows ((width + 7) / 8 bytes per row)
+         */
+        static std::vector<uint8_t> parsePBMFilePacked(
+            const std::string &filename,
+            int &width,
+            int &height);
+
+        /**
+         * Writes a bit matrix to a binary (P4) PBM file.
+         *
+         * @param filename Path to the output PBM file
+         * @param data Bit data (one byte per pixel, non-zero = black)
+         * @param width Matrix width
+         * @param height Matrix height
+         * @return True if the file was written successfully, false otherwise
+         */
+        static bool writePBMFile(
+            const std::string &filename,
+            const std::vector<uint8_t> &data,
+            int width,
+            int height);
+
+        /**
+         * Writes a bit-packed matrix to a binary (P4) PBM file.
+         *
+         * @param filename Path to the output PBM file
+         * @param packed Packed rows ((width + 7) / 8 bytes per row, MSB first)
+         * @param width Matrix width
+         * @param height Matrix height
+         * @return True if the file was written successfully, false otherwise
+         */
+        static bool writePBMFilePacked(
+            const std::string &filename,
+            const std::vector<uint8_t> &packed,
+            int width,
+            int height);
+
+        /**
+         * Unpacks one MSB-first packed row into one byte per pixel (0 or 1).
+         *
+         * @param packed Packed row data
+         * @param out Output buffer of at least width bytes
+         * @param width Number of pixels in the row
+         */
+        static void unpackRow(const uint8_t *packed, uint8_t *out, size_t width);
+
+        /**
+         * Packs one row of pixels (non-zero = set) into MSB-first bytes.
+         *
+         * @param pixels Row data, one byte per pixel
+         * @param out Output buffer of at least (width + 7) / 8 bytes
+         * @param width Number of pixels in the row
+         */
+        static void packRow(const uint8_t *pixels, uint8_t *out, size_t width);
     };
 }
 
 
 
-#endif // PBMUTILS_H
\ No newline at end of file
+#endif // PBMUTILS_H
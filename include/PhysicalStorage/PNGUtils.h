@@ -0,0 +1,51 @@
+#ifndef PNGUTILS_H
+#define PNGUTILS_H
+
+#include "StorageCommon.hpp"
+
+
+namespace PhysicalStorage {
+    class PNGUtils {
+    public:
+        /**
+         * Writes a greyscale PNG from packed samples.
+         * Row groups are deflated independently on worker threads and joined with
+         * sync flushes into a single zlib stream.
+         *
+         * @param filename Path to the output PNG file
+         * @param packed Packed rows, MSB first, (width * bitDepth + 7) / 8 bytes per row
+         * @param width Image width in pixels
+         * @param height Image height in pixels
+         * @param bitDepth Bits per sample (1, 2, 4 or 8), higher values are brighter
+         * @param threads Number of worker threads (0 = hardware concurrency)
+         * @return True if the file was written successfully, false otherwise
+         */
+        static bool writeGreyscalePNG(
+            const std::string &filename,
+            const std::vector<uint8_t> &packed,
+            int width,
+            int height,
+            int bitDepth = 8,
+            unsigned int threads = 0);
+
+        /**
+         * Writes a bilevel (bit depth 1) PNG from a bit-packed matrix.
+         *
+         * @param filename Path to the output PNG file
+         * @param packed Packed rows as in P4 PBM files ((width + 7) / 8 bytes per row, 1 = black)
+         * @param width Image width in pixels
+         * @param height Image height in pixels
+         * @param threads Number of worker threads (0 = hardware concurrency)
+         * @return True if the file was written successfully, false otherwise
+         */
+        static bool writeBilevelPNG(
+            const std::string &filename,
+            const std::vector<uint8_t> &packed,
+            int width,
+            int height,
+            unsigned int threads = 0);
+    };
+}
+
+
+#endif // PNGUTILS_H
@@ -23,24 +23,90 @@ namespace PhysicalStorage {
     class QRCodeStorage {
     public:
         /**
-         * Creates a QR code from binary data and writes it to a file in PNG format.
+         * Creates a QR code from a file and writes it to a file in PNG format.
          *
-         * @param data Binary data to encode
-         * @param filename Output filename for the QR code
-         * @param errorCorrectionLevel QR code error correction level (default: QR_ECLEVEL_H)
+         * @param in Path to the file to encode
+         * @param out Output filename for the QR code
+         * @param levels Grey levels per module (see bytesToQR)
          * @return True if QR code was created successfully, false otherwise
          */
         static bool fileToQR(
             const std::string &in,
-            const std::string &out);
+            const std::string &out,
+            int levels = 2);
+
+        /**
+         * Creates a QR code from binary data in memory and writes it to a file in PNG
+         * (or PBM, by extension) format.
+         *
+         * @param data Binary data to encode
+         * @param out Output filename for the QR code
+         * @param levels Grey levels per module: 2 (one bit), 4 or 8 (Gray-coded, with
+         *               calibration rows and codewords interleaved across modules).
+         *               Scans need about 5 px per module for 4 levels, 6 px for 8
+         * @return True if QR code was created successfully, false otherwise
+         */
+        static bool bytesToQR(
+            const std::vector<uint8_t> &data,
+            const std::string &out,
+            int levels = 2);
 
         /**
          * Reads a QR code from a PNG file and decodes it to binary data.
+         * The number of grey levels is detected from the page width.
          *
-         * @param filename Path to the QR code PNG file
+         * @param in Path to the QR code PNG file
          * @return The decoded binary data, or empty vector on error
          */
+        static std::vector<uint8_t> QRToBytes(const std::string &in);
+
+        /**
+         * Reads a QR code from a PNG file and writes the decoded data to a file.
+         *
+         * @param in Path to the QR code PNG file
+         * @param out Output file path
+         * @return True if the file was written successfully, false otherwise
+         */
         static bool QRToFile(const std::string &in, const std::string &out);
+
+        /**
+         * Splits a file into segments and writes each one as a real QR code page
+         * (PNG) into a directory. Every segment starts with a small header holding
+         * its sequence number and the total number of segments.
+         *
+         * @param in Path to the file to store
+         * @param outDir Directory receiving the page images
+         * @return True if every page was written successfully, false otherwise
+         */
+        static bool fileToQRPages(const std::string &in, const std::string &outDir);
+
+        /**
+         * Splits binary data held in memory into QR code pages, as fileToQRPages.
+         *
+         * @param data Binary data to store
+         * @param outDir Directory receiving the page images
+         * @return True if every page was written successfully, false otherwise
+         */
+        static bool bytesToQRPages(const std::vector<uint8_t> &data, const std::string &outDir);
+
+        /**
+         * Scans a directory of QR code page images with zbar across worker threads,
+         * reorders the segments by sequence number and rebuilds the file in memory.
+         *
+         * @param inDir Directory containing the page images
+         * @param threads Number of worker threads (0 = hardware concurrency)
+         * @return The reassembled data, or empty vector on error
+         */
+        static std::vector<uint8_t> QRPagesToBytes(const std::string &inDir, unsigned int threads = 0);
+
+        /**
+         * Scans a directory of QR code page images and writes the rebuilt file.
+         *
+         * @param inDir Directory containing the page images
+         * @param out Output file path
+         * @return True if the file was rebuilt successfully, false otherwise
+         */
+        static bool QRPagesToFile(const std::string &inDir, const std::string &out);
     };
 } // namespace PhysicalStorage
 
@@ -12,6 +12,7 @@ namespace PhysicalStorage {
     public:
         /**
          * Renders a QR code from a PBM file using raylib.
+         * The code is uploaded once as a texture and drawn as a single quad.
          *
          * @param filename Path to the PBM file containing the QR code
          * @param windowTitle Window title (default: "QR Code Visualization")
@@ -26,8 +27,9 @@ namespace PhysicalStorage {
 
         /**
          * Renders a binary matrix directly from memory using raylib.
+         * The matrix is uploaded once as a texture and drawn as a single quad.
          *
-         * @param data Binary data to visualize as a matrix
+         * @param data Packed rows as in P4 PBM files ((width + 7) / 8 bytes per row, 1 = black)
          * @param width Matrix width in bits
          * @param height Matrix height in bits
          * @param windowTitle Window title (default: "Matrix Visualization")
@@ -44,11 +46,13 @@ namespace PhysicalStorage {
 
         /**
          * Saves a visualization of a bit matrix to an image file.
+         * The matrix is scaled (nearest neighbour) while still bit-packed; PNG and PBM
+         * files are written at 1 bit per pixel, BMP, TGA and JPEG through stb.
          *
-         * @param data Binary data to visualize as a matrix
+         * @param data Packed rows as in P4 PBM files ((width + 7) / 8 bytes per row, 1 = black)
          * @param width Matrix width in bits
          * @param height Matrix height in bits
-         * @param outputFilename Path to save the visualization image
+         * @param outputFilename Path to save the visualization image, the extension selects the format
          * @param imageWidth Image width in pixels (default: 800)
          * @param imageHeight Image height in pixels (default: 800)
          * @return True if the image was saved successfully, false otherwise
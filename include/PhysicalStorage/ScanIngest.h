@@ -0,0 +1,84 @@
+#ifndef SCAN_INGEST_H
+#define SCAN_INGEST_H
+
+#include "StorageCommon.hpp"
+
+
+namespace PhysicalStorage {
+    /**
+     * Module matrix recovered from a scanned page.
+     */
+    struct ModuleGrid {
+        std::vector<uint8_t> modules; // One byte per module, 1 = dark
+        std::vector<uint8_t> grey;    // Mean grey value around each module centre
+        int width = 0;                // Width in modules
+        int height = 0;               // Height in modules
+        double pitchX = 0.0;          // Module pitch in pixels
+        double pitchY = 0.0;
+    };
+
+    /**
+     * Turns greyscale page scans into module matrices: adaptive thresholding,
+     * module pitch detection and sampling of module centres.
+     */
+    class ScanIngest {
+    public:
+        /**
+         * Binarises a greyscale image with an adaptive (local mean) threshold.
+         * A pixel is dark when it is darker than the mean of its window by more
+         * than the given fraction.
+         *
+         * @param grey Greyscale pixels, row-major
+         * @param width Image width in pixels
+         * @param height Image height in pixels
+         * @param window Side of the averaging window in pixels (0 = derived from the image size)
+         * @param sensitivity Fraction below the local mean that counts as dark (default: 0.15)
+         * @return One byte per pixel, 1 = dark
+         */
+        static std::vector<uint8_t> binarize(
+            const uint8_t *grey,
+            int width,
+            int height,
+            int window = 0,
+            float sensitivity = 0.15f);
+
+        /**
+         * Estimates the module pitch along rows and columns from the autocorrelation
+         * of the image's edge profiles.
+         *
+         * @param grey Greyscale pixels, row-major
+         * @param width Image width in pixels
+         * @param height Image height in pixels
+         * @param pitchX Output parameter for the horizontal pitch in pixels
+         * @param pitchY Output parameter for the vertical pitch in pixels
+         * @return True if a pitch could be estimated, false otherwise
+         */
+        static bool estimatePitch(
+            const uint8_t *grey,
+            int width,
+            int height,
+            double &pitchX,
+            double &pitchY);
+
+        /**
+         * Recovers the module matrix of a scanned page. The page is located by the
+         * bounding box of its dark modules, so its first and last rows and columns
+         * must each contain a dark module.
+         *
+         * @param grey Greyscale pixels, row-major
+         * @param width Image width in pixels
+         * @param height Image height in pixels
+         * @param allowedWidths Possible page widths in modules; the one matching the
+         *                      measured pitch best is used (empty = derive from the pitch)
+         * @return The sampled module matrix (empty on error)
+         */
+        static ModuleGrid sampleModules(
+            const uint8_t *grey,
+            int width,
+            int height,
+            const std::vector<int> &allowedWidths = {});
+    };
+}
+
+
+#endif // SCAN_INGEST_H
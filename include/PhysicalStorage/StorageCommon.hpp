@@ -30,6 +30,18 @@ namespace PhysicalStorage {
         const std::string MATRIX_CHUNK_EXT = ".chunk";
         const std::string QR_CODE_EXT = ".pbm";
         const std::string METADATA_EXT = ".metadata";
+        const std::string QR_PAGE_EXT = ".png";
+
+        // QR code page layout
+        const std::string QR_PAGE_MAGIC = "DNSQ";           // Segment header magic
+        constexpr size_t QR_PAGE_HEADER_SIZE = 12;          // Magic + sequence + total
+        constexpr size_t QR_PAGE_PAYLOAD_SIZE = 2048;       // Data bytes per page
+        constexpr int QR_PAGE_MODULE_PIXELS = 4;            // Pixels per QR module
+        constexpr int QR_PAGE_QUIET_ZONE = 4;               // Quiet zone in modules
+
+        // Multi-level greyscale pages
+        constexpr int MAX_MODULE_LEVELS = 8;                // Up to 3 bits per module
+        constexpr int LEVEL_PAGE_LENGTH_BYTES = 4;          // Data length stored before the data
     }
 
     /**
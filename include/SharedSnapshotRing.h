@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "SnapshotChannel.h"
+
+/*
+ * Snapshot ring in POSIX shared memory, letting a separate viewer process
+ * (denis-view) watch a running encode or decode. The encoder is the only
+ * writer; each slot is guarded by a sequence lock, so readers never block it
+ * and retry instead when they catch a slot mid-write. Viewers refresh a
+ * heartbeat while attached, and the encoder skips sampling entirely when no
+ * heartbeat is recent, so unwatched runs pay nothing.
+ */
+struct SharedRingLayout;
+
+class SharedSnapshotPublisher {
+public:
+    // Creates (or takes over) the shared memory object, throws std::runtime_error on failure
+    explicit SharedSnapshotPublisher(const std::string &name);
+
+    ~SharedSnapshotPublisher();
+
+    // True while at least one viewer is attached
+    bool hasViewers() const;
+
+    // Writes a snapshot into the next slot
+    void publish(const GridSnapshot &snapshot);
+
+private:
+    std::string m_name;
+    SharedRingLayout *m_ring = nullptr;
+};
+
+class SharedSnapshotViewer {
+public:
+    // Attaches to a publisher's shared memory object, throws std::runtime_error on failure
+    explicit SharedSnapshotViewer(const std::string &name);
+
+    ~SharedSnapshotViewer();
+
+    // Copies the latest snapshot if one was published since the last call;
+    // also refreshes the heartbeat, so call it at least a few times per second
+    bool latest(GridSnapshot &snapshot);
+
+    // False once the publisher has finished or exited
+    bool publisherAlive() const;
+
+private:
+    SharedRingLayout *m_ring = nullptr;
+    uint64_t m_lastSeen = 0;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <CellularAutomaton.h>
+
+// Both grids of one generation, bit-packed (16 KB), with progress information
+struct GridSnapshot {
+    PackedGrid currentGrid;
+    PackedGrid prevGrid;
+    int chunkIndex;
+    int totalChunks;
+    int iteration;
+    int totalIterations;
+};
+
+// Packs a grid of 0/1 cells into a bit-packed grid
+void packGrid(const int *cells, PackedGrid &packed);
+
+inline void packGrid(const std::array<int, BUFFER_SIZE> &grid, PackedGrid &packed) {
+    packGrid(grid.data(), packed);
+}
+
+// Unpacks a bit-packed grid into 0/1 cells
+void unpackGrid(const PackedGrid &packed, std::array<int, BUFFER_SIZE> &grid);
+
+/*
+ * Lock-free triple buffer handing the latest snapshot from one producer thread
+ * to one consumer thread. The producer fills its back slot and swaps it with the
+ * middle slot; the consumer swaps the middle slot for its front slot only when a
+ * fresh snapshot was published. Neither side ever blocks or allocates, and
+ * snapshots the consumer had no time for are simply overwritten.
+ */
+class SnapshotChannel {
+public:
+    SnapshotChannel();
+
+    // Producer: slot to fill before calling publish()
+    GridSnapshot &back() { return m_slots[m_back]; }
+
+    // Producer: makes the back slot the latest snapshot
+    void publish();
+
+    // Consumer: moves to the latest snapshot, returns false if there is none newer
+    bool acquire();
+
+    // Consumer: snapshot acquired last, valid until the next acquire()
+    const GridSnapshot &front() const { return m_slots[m_front]; }
+
+private:
+    static constexpr uint8_t FRESH = 0x4;   // Set in m_middle when not yet acquired
+    static constexpr uint8_t INDEX = 0x3;
+
+    std::unique_ptr<GridSnapshot[]> m_slots;
+
+    alignas(64) std::atomic<uint8_t> m_middle;
+    alignas(64) uint8_t m_back;    // Owned by the producer
+    alignas(64) uint8_t m_front;   // Owned by the consumer
+};
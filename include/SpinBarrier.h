@@ -0,0 +1,21 @@
+#pragma once
+
+#include <atomic>
+
+/*
+ * Reusable barrier for a fixed number of threads that meet every few microseconds.
+ * Waiting threads spin on the barrier's phase instead of sleeping, then yield once
+ * the wait gets long, so oversubscribed cores still make progress.
+ */
+class SpinBarrier {
+public:
+    explicit SpinBarrier(int participants);
+
+    // Returns once all participants have called wait() for the current phase
+    void wait();
+
+private:
+    const int m_participants;
+    alignas(64) std::atomic<int> m_waiting{0};
+    alignas(64) std::atomic<unsigned> m_phase{0};
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "SnapshotChannel.h"
+
+/*
+ * Trace files record sampled generations of a run for later replay.
+ *
+ * Header:  "DNST", version (1 byte), grid side (2 bytes)
+ * Frame:   flags (1 byte, bit 0 = key frame), chunk index, total chunks,
+ *          iteration, total iterations, compressed size (4 bytes each),
+ *          then both bit-packed grids, deflated. Key frames hold the grids
+ *          themselves, other frames their XOR with the previous frame, which
+ *          is mostly zero and compresses to a few hundred bytes.
+ *
+ * All integers are little-endian. Traces store the iteration count, which is
+ * part of the key: keep them as private as the key itself.
+ */
+class TraceRecorder {
+public:
+    // Creates the trace file, throws std::runtime_error on failure
+    explicit TraceRecorder(const std::string &path);
+
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder &) = delete;
+
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    // Appends one snapshot to the trace
+    void record(const GridSnapshot &snapshot);
+
+    // Flushes and closes the trace file
+    void close();
+
+private:
+    static constexpr int KEY_FRAME_INTERVAL = 256;
+
+    FILE *m_file = nullptr;
+    GridSnapshot m_previous{};
+    std::vector<uint8_t> m_delta;
+    std::vector<uint8_t> m_compressed;
+    uint64_t m_frames = 0;
+};
+
+class TraceReader {
+public:
+    // Opens a trace file and checks its header, throws std::runtime_error on failure
+    explicit TraceReader(const std::string &path);
+
+    // Reads the next snapshot, returns false at the end of the trace
+    bool next(GridSnapshot &snapshot);
+
+    // Writes every remaining frame as a Y4M (monochrome) video, live cells black
+    void exportY4M(const std::string &path, int framesPerSecond = 30);
+
+    // Writes every remaining frame as frame_NNNNNN.png into a directory
+    void exportPNG(const std::string &directory);
+
+private:
+    std::ifstream m_file;
+    GridSnapshot m_previous{};
+    std::vector<uint8_t> m_compressed;
+    std::vector<uint8_t> m_delta;
+};
@@ -10,7 +10,15 @@
 #include <iomanip>
 #include <cstring>
 #include <bitset>
+#include <csignal>
+#include <chrono>
+#include <memory>
+#include <map>
+#include <set>
+#include <functional>
 #include <argparse/argparse.hpp>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "FormatManager/FileManagementHelper.hpp"
 #include "FormatManager/DenisEncoder.hpp"
@@ -0,0 +1,64 @@
+#version 430 core
+
+// Lists the 16x16 tiles a Moore step must compute, one invocation per tile, and
+// writes the step's indirect dispatch size. A tile is live in a buffer when its
+// flag equals the buffer's stamp (flags are never cleared, only restamped). The
+// step runs for tiles that may become live, because a tile around them in the
+// source grid or the tile itself in the other grid is live, and for tiles that
+// were live in the output buffer, which must be cleared
+layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;   // (gridSize / 16)^2 tiles
+layout(std430, binding = 4) buffer Activity { uint tile_active[]; };
+layout(std430, binding = 5) buffer ActiveTiles { uint dispatch_size[3]; uint active_tiles[]; };
+
+// Buffers of the grid whose neighbourhoods are counted, of the grid XORed in and
+// of the output, and their stamps (the output's before this step)
+layout(location = 0) uniform ivec3 activity_slots;
+layout(location = 1) uniform uvec3 activity_stamps;
+
+#ifndef TOROIDAL
+#define TOROIDAL 0
+#endif
+
+const int gridSize = 256;
+const int tilesPerRow = gridSize / 16;
+const int tileCount = tilesPerRow * tilesPerRow;
+
+shared uint activeCount;
+
+bool tileLive(int slot, uint stamp, ivec2 tile) {
+    return tile_active[slot * tileCount + tile.y * tilesPerRow + tile.x] == stamp;
+}
+
+void main() {
+    int index = int(gl_LocalInvocationIndex);
+    ivec2 tile = ivec2(index % tilesPerRow, index / tilesPerRow);
+
+    if (index == 0) activeCount = 0u;
+    barrier();
+
+    bool listed = tileLive(activity_slots.y, activity_stamps.y, tile) ||
+                  tileLive(activity_slots.z, activity_stamps.z, tile);
+    for (int dy = -1; dy <= 1 && !listed; dy++) {
+        for (int dx = -1; dx <= 1 && !listed; dx++) {
+            ivec2 neighbour = tile + ivec2(dx, dy);
+#if TOROIDAL
+            neighbour = (neighbour + tilesPerRow) % tilesPerRow;
+#else
+            if (any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, ivec2(tilesPerRow)))) continue;
+#endif
+            listed = tileLive(activity_slots.x, activity_stamps.x, neighbour);
+        }
+    }
+
+    if (listed) {
+        active_tiles[atomicAdd(activeCount, 1u)] = uint(index);
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (index == 0) {
+        dispatch_size[0] = activeCount;
+        dispatch_size[1] = 1u;
+        dispatch_size[2] = 1u;
+    }
+}
@@ -0,0 +1,200 @@
+unsigned char gol_activity_glsl[] = {
+  0x23, 0x76, 0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x34, 0x33, 0x30,
+  0x20, 0x63, 0x6f, 0x72, 0x65, 0x0a, 0x0a, 0x2f, 0x2f, 0x20, 0x4c, 0x69,
+  0x73, 0x74, 0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x31, 0x36, 0x78, 0x31,
+  0x36, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x20, 0x61, 0x20, 0x4d, 0x6f,
+  0x6f, 0x72, 0x65, 0x20, 0x73, 0x74, 0x65, 0x70, 0x20, 0x6d, 0x75, 0x73,
+  0x74, 0x20, 0x63, 0x6f, 0x6d, 0x70, 0x75, 0x74, 0x65, 0x2c, 0x20, 0x6f,
+  0x6e, 0x65, 0x20, 0x69, 0x6e, 0x76, 0x6f, 0x63, 0x61, 0x74, 0x69, 0x6f,
+  0x6e, 0x20, 0x70, 0x65, 0x72, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x2c, 0x20,
+  0x61, 0x6e, 0x64, 0x0a, 0x2f, 0x2f, 0x20, 0x77, 0x72, 0x69, 0x74, 0x65,
+  0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x73, 0x74, 0x65, 0x70, 0x27, 0x73,
+  0x20, 0x69, 0x6e, 0x64, 0x69, 0x72, 0x65, 0x63, 0x74, 0x20, 0x64, 0x69,
+  0x73, 0x70, 0x61, 0x74, 0x63, 0x68, 0x20, 0x73, 0x69, 0x7a, 0x65, 0x2e,
+  0x20, 0x41, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x20, 0x69, 0x73, 0x20, 0x6c,
+  0x69, 0x76, 0x65, 0x20, 0x69, 0x6e, 0x20, 0x61, 0x20, 0x62, 0x75, 0x66,
+  0x66, 0x65, 0x72, 0x20, 0x77, 0x68, 0x65, 0x6e, 0x20, 0x69, 0x74, 0x73,
+  0x0a, 0x2f, 0x2f, 0x20, 0x66, 0x6c, 0x61, 0x67, 0x20, 0x65, 0x71, 0x75,
+  0x61, 0x6c, 0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x62, 0x75, 0x66, 0x66,
+  0x65, 0x72, 0x27, 0x73, 0x20, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x20, 0x28,
+  0x66, 0x6c, 0x61, 0x67, 0x73, 0x20, 0x61, 0x72, 0x65, 0x20, 0x6e, 0x65,
+  0x76, 0x65, 0x72, 0x20, 0x63, 0x6c, 0x65, 0x61, 0x72, 0x65, 0x64, 0x2c,
+  0x20, 0x6f, 0x6e, 0x6c, 0x79, 0x20, 0x72, 0x65, 0x73, 0x74, 0x61, 0x6d,
+  0x70, 0x65, 0x64, 0x29, 0x2e, 0x20, 0x54, 0x68, 0x65, 0x0a, 0x2f, 0x2f,
+  0x20, 0x73, 0x74, 0x65, 0x70, 0x20, 0x72, 0x75, 0x6e, 0x73, 0x20, 0x66,
+  0x6f, 0x72, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x20, 0x74, 0x68, 0x61,
+  0x74, 0x20, 0x6d, 0x61, 0x79, 0x20, 0x62, 0x65, 0x63, 0x6f, 0x6d, 0x65,
+  0x20, 0x6c, 0x69, 0x76, 0x65, 0x2c, 0x20, 0x62, 0x65, 0x63, 0x61, 0x75,
+  0x73, 0x65, 0x20, 0x61, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x20, 0x61, 0x72,
+  0x6f, 0x75, 0x6e, 0x64, 0x20, 0x74, 0x68, 0x65, 0x6d, 0x20, 0x69, 0x6e,
+  0x20, 0x74, 0x68, 0x65, 0x0a, 0x2f, 0x2f, 0x20, 0x73, 0x6f, 0x75, 0x72,
+  0x63, 0x65, 0x20, 0x67, 0x72, 0x69, 0x64, 0x20, 0x6f, 0x72, 0x20, 0x74,
+  0x68, 0x65, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x20, 0x69, 0x74, 0x73, 0x65,
+  0x6c, 0x66, 0x20, 0x69, 0x6e, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6f, 0x74,
+  0x68, 0x65, 0x72, 0x20, 0x67, 0x72, 0x69, 0x64, 0x20, 0x69, 0x73, 0x20,
+  0x6c, 0x69, 0x76, 0x65, 0x2c, 0x20, 0x61, 0x6e, 0x64, 0x20, 0x66, 0x6f,
+  0x72, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x20, 0x74, 0x68, 0x61, 0x74,
+  0x0a, 0x2f, 0x2f, 0x20, 0x77, 0x65, 0x72, 0x65, 0x20, 0x6c, 0x69, 0x76,
+  0x65, 0x20, 0x69, 0x6e, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6f, 0x75, 0x74,
+  0x70, 0x75, 0x74, 0x20, 0x62, 0x75, 0x66, 0x66, 0x65, 0x72, 0x2c, 0x20,
+  0x77, 0x68, 0x69, 0x63, 0x68, 0x20, 0x6d, 0x75, 0x73, 0x74, 0x20, 0x62,
+  0x65, 0x20, 0x63, 0x6c, 0x65, 0x61, 0x72, 0x65, 0x64, 0x0a, 0x6c, 0x61,
+  0x79, 0x6f, 0x75, 0x74, 0x20, 0x28, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x5f,
+  0x73, 0x69, 0x7a, 0x65, 0x5f, 0x78, 0x20, 0x3d, 0x20, 0x32, 0x35, 0x36,
+  0x2c, 0x20, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x5f, 0x73, 0x69, 0x7a, 0x65,
+  0x5f, 0x79, 0x20, 0x3d, 0x20, 0x31, 0x2c, 0x20, 0x6c, 0x6f, 0x63, 0x61,
+  0x6c, 0x5f, 0x73, 0x69, 0x7a, 0x65, 0x5f, 0x7a, 0x20, 0x3d, 0x20, 0x31,
+  0x29, 0x20, 0x69, 0x6e, 0x3b, 0x20, 0x20, 0x20, 0x2f, 0x2f, 0x20, 0x28,
+  0x67, 0x72, 0x69, 0x64, 0x53, 0x69, 0x7a, 0x65, 0x20, 0x2f, 0x20, 0x31,
+  0x36, 0x29, 0x5e, 0x32, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x0a, 0x6c,
+  0x61, 0x79, 0x6f, 0x75, 0x74, 0x28, 0x73, 0x74, 0x64, 0x34, 0x33, 0x30,
+  0x2c, 0x20, 0x62, 0x69, 0x6e, 0x64, 0x69, 0x6e, 0x67, 0x20, 0x3d, 0x20,
+  0x34, 0x29, 0x20, 0x62, 0x75, 0x66, 0x66, 0x65, 0x72, 0x20, 0x41, 0x63,
+  0x74, 0x69, 0x76, 0x69, 0x74, 0x79, 0x20, 0x7b, 0x20, 0x75, 0x69, 0x6e,
+  0x74, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x5f, 0x61, 0x63, 0x74, 0x69, 0x76,
+  0x65, 0x5b, 0x5d, 0x3b, 0x20, 0x7d, 0x3b, 0x0a, 0x6c, 0x61, 0x79, 0x6f,
+  0x75, 0x74, 0x28, 0x73, 0x74, 0x64, 0x34, 0x33, 0x30, 0x2c, 0x20, 0x62,
+  0x69, 0x6e, 0x64, 0x69, 0x6e, 0x67, 0x20, 0x3d, 0x20, 0x35, 0x29, 0x20,
+  0x62, 0x75, 0x66, 0x66, 0x65, 0x72, 0x20, 0x41, 0x63, 0x74, 0x69, 0x76,
+  0x65, 0x54, 0x69, 0x6c, 0x65, 0x73, 0x20, 0x7b, 0x20, 0x75, 0x69, 0x6e,
+  0x74, 0x20, 0x64, 0x69, 0x73, 0x70, 0x61, 0x74, 0x63, 0x68, 0x5f, 0x73,
+  0x69, 0x7a, 0x65, 0x5b, 0x33, 0x5d, 0x3b, 0x20, 0x75, 0x69, 0x6e, 0x74,
+  0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65, 0x5f, 0x74, 0x69, 0x6c, 0x65,
+  0x73, 0x5b, 0x5d, 0x3b, 0x20, 0x7d, 0x3b, 0x0a, 0x0a, 0x2f, 0x2f, 0x20,
+  0x42, 0x75, 0x66, 0x66, 0x65, 0x72, 0x73, 0x20, 0x6f, 0x66, 0x20, 0x74,
+  0x68, 0x65, 0x20, 0x67, 0x72, 0x69, 0x64, 0x20, 0x77, 0x68, 0x6f, 0x73,
+  0x65, 0x20, 0x6e, 0x65, 0x69, 0x67, 0x68, 0x62, 0x6f, 0x75, 0x72, 0x68,
+  0x6f, 0x6f, 0x64, 0x73, 0x20, 0x61, 0x72, 0x65, 0x20, 0x63, 0x6f, 0x75,
+  0x6e, 0x74, 0x65, 0x64, 0x2c, 0x20, 0x6f, 0x66, 0x20, 0x74, 0x68, 0x65,
+  0x20, 0x67, 0x72, 0x69, 0x64, 0x20, 0x58, 0x4f, 0x52, 0x65, 0x64, 0x20,
+  0x69, 0x6e, 0x20, 0x61, 0x6e, 0x64, 0x0a, 0x2f, 0x2f, 0x20, 0x6f, 0x66,
+  0x20, 0x74, 0x68, 0x65, 0x20, 0x6f, 0x75, 0x74, 0x70, 0x75, 0x74, 0x2c,
+  0x20, 0x61, 0x6e, 0x64, 0x20, 0x74, 0x68, 0x65, 0x69, 0x72, 0x20, 0x73,
+  0x74, 0x61, 0x6d, 0x70, 0x73, 0x20, 0x28, 0x74, 0x68, 0x65, 0x20, 0x6f,
+  0x75, 0x74, 0x70, 0x75, 0x74, 0x27, 0x73, 0x20, 0x62, 0x65, 0x66, 0x6f,
+  0x72, 0x65, 0x20, 0x74, 0x68, 0x69, 0x73, 0x20, 0x73, 0x74, 0x65, 0x70,
+  0x29, 0x0a, 0x6c, 0x61, 0x79, 0x6f, 0x75, 0x74, 0x28, 0x6c, 0x6f, 0x63,
+  0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x3d, 0x20, 0x30, 0x29, 0x20, 0x75,
+  0x6e, 0x69, 0x66, 0x6f, 0x72, 0x6d, 0x20, 0x69, 0x76, 0x65, 0x63, 0x33,
+  0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x69, 0x74, 0x79, 0x5f, 0x73, 0x6c,
+  0x6f, 0x74, 0x73, 0x3b, 0x0a, 0x6c, 0x61, 0x79, 0x6f, 0x75, 0x74, 0x28,
+  0x6c, 0x6f, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x3d, 0x20, 0x31,
+  0x29, 0x20, 0x75, 0x6e, 0x69, 0x66, 0x6f, 0x72, 0x6d, 0x20, 0x75, 0x76,
+  0x65, 0x63, 0x33, 0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x69, 0x74, 0x79,
+  0x5f, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x73, 0x3b, 0x0a, 0x0a, 0x23, 0x69,
+  0x66, 0x6e, 0x64, 0x65, 0x66, 0x20, 0x54, 0x4f, 0x52, 0x4f, 0x49, 0x44,
+  0x41, 0x4c, 0x0a, 0x23, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x20, 0x54,
+  0x4f, 0x52, 0x4f, 0x49, 0x44, 0x41, 0x4c, 0x20, 0x30, 0x0a, 0x23, 0x65,
+  0x6e, 0x64, 0x69, 0x66, 0x0a, 0x0a, 0x63, 0x6f, 0x6e, 0x73, 0x74, 0x20,
+  0x69, 0x6e, 0x74, 0x20, 0x67, 0x72, 0x69, 0x64, 0x53, 0x69, 0x7a, 0x65,
+  0x20, 0x3d, 0x20, 0x32, 0x35, 0x36, 0x3b, 0x0a, 0x63, 0x6f, 0x6e, 0x73,
+  0x74, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x50,
+  0x65, 0x72, 0x52, 0x6f, 0x77, 0x20, 0x3d, 0x20, 0x67, 0x72, 0x69, 0x64,
+  0x53, 0x69, 0x7a, 0x65, 0x20, 0x2f, 0x20, 0x31, 0x36, 0x3b, 0x0a, 0x63,
+  0x6f, 0x6e, 0x73, 0x74, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x74, 0x69, 0x6c,
+  0x65, 0x43, 0x6f, 0x75, 0x6e, 0x74, 0x20, 0x3d, 0x20, 0x74, 0x69, 0x6c,
+  0x65, 0x73, 0x50, 0x65, 0x72, 0x52, 0x6f, 0x77, 0x20, 0x2a, 0x20, 0x74,
+  0x69, 0x6c, 0x65, 0x73, 0x50, 0x65, 0x72, 0x52, 0x6f, 0x77, 0x3b, 0x0a,
+  0x0a, 0x73, 0x68, 0x61, 0x72, 0x65, 0x64, 0x20, 0x75, 0x69, 0x6e, 0x74,
+  0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65, 0x43, 0x6f, 0x75, 0x6e, 0x74,
+  0x3b, 0x0a, 0x0a, 0x62, 0x6f, 0x6f, 0x6c, 0x20, 0x74, 0x69, 0x6c, 0x65,
+  0x4c, 0x69, 0x76, 0x65, 0x28, 0x69, 0x6e, 0x74, 0x20, 0x73, 0x6c, 0x6f,
+  0x74, 0x2c, 0x20, 0x75, 0x69, 0x6e, 0x74, 0x20, 0x73, 0x74, 0x61, 0x6d,
+  0x70, 0x2c, 0x20, 0x69, 0x76, 0x65, 0x63, 0x32, 0x20, 0x74, 0x69, 0x6c,
+  0x65, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x72, 0x65, 0x74,
+  0x75, 0x72, 0x6e, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x5f, 0x61, 0x63, 0x74,
+  0x69, 0x76, 0x65, 0x5b, 0x73, 0x6c, 0x6f, 0x74, 0x20, 0x2a, 0x20, 0x74,
+  0x69, 0x6c, 0x65, 0x43, 0x6f, 0x75, 0x6e, 0x74, 0x20, 0x2b, 0x20, 0x74,
+  0x69, 0x6c, 0x65, 0x2e, 0x79, 0x20, 0x2a, 0x20, 0x74, 0x69, 0x6c, 0x65,
+  0x73, 0x50, 0x65, 0x72, 0x52, 0x6f, 0x77, 0x20, 0x2b, 0x20, 0x74, 0x69,
+  0x6c, 0x65, 0x2e, 0x78, 0x5d, 0x20, 0x3d, 0x3d, 0x20, 0x73, 0x74, 0x61,
+  0x6d, 0x70, 0x3b, 0x0a, 0x7d, 0x0a, 0x0a, 0x76, 0x6f, 0x69, 0x64, 0x20,
+  0x6d, 0x61, 0x69, 0x6e, 0x28, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20,
+  0x20, 0x69, 0x6e, 0x74, 0x20, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x20, 0x3d,
+  0x20, 0x69, 0x6e, 0x74, 0x28, 0x67, 0x6c, 0x5f, 0x4c, 0x6f, 0x63, 0x61,
+  0x6c, 0x49, 0x6e, 0x76, 0x6f, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x49,
+  0x6e, 0x64, 0x65, 0x78, 0x29, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x69,
+  0x76, 0x65, 0x63, 0x32, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x20, 0x3d, 0x20,
+  0x69, 0x76, 0x65, 0x63, 0x32, 0x28, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x20,
+  0x25, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x50, 0x65, 0x72, 0x52, 0x6f,
+  0x77, 0x2c, 0x20, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x20, 0x2f, 0x20, 0x74,
+  0x69, 0x6c, 0x65, 0x73, 0x50, 0x65, 0x72, 0x52, 0x6f, 0x77, 0x29, 0x3b,
+  0x0a, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x69, 0x66, 0x20, 0x28, 0x69, 0x6e,
+  0x64, 0x65, 0x78, 0x20, 0x3d, 0x3d, 0x20, 0x30, 0x29, 0x20, 0x61, 0x63,
+  0x74, 0x69, 0x76, 0x65, 0x43, 0x6f, 0x75, 0x6e, 0x74, 0x20, 0x3d, 0x20,
+  0x30, 0x75, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x62, 0x61, 0x72, 0x72,
+  0x69, 0x65, 0x72, 0x28, 0x29, 0x3b, 0x0a, 0x0a, 0x20, 0x20, 0x20, 0x20,
+  0x62, 0x6f, 0x6f, 0x6c, 0x20, 0x6c, 0x69, 0x73, 0x74, 0x65, 0x64, 0x20,
+  0x3d, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x4c, 0x69, 0x76, 0x65, 0x28, 0x61,
+  0x63, 0x74, 0x69, 0x76, 0x69, 0x74, 0x79, 0x5f, 0x73, 0x6c, 0x6f, 0x74,
+  0x73, 0x2e, 0x79, 0x2c, 0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x69, 0x74,
+  0x79, 0x5f, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x73, 0x2e, 0x79, 0x2c, 0x20,
+  0x74, 0x69, 0x6c, 0x65, 0x29, 0x20, 0x7c, 0x7c, 0x0a, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x74, 0x69, 0x6c, 0x65, 0x4c, 0x69, 0x76, 0x65, 0x28,
+  0x61, 0x63, 0x74, 0x69, 0x76, 0x69, 0x74, 0x79, 0x5f, 0x73, 0x6c, 0x6f,
+  0x74, 0x73, 0x2e, 0x7a, 0x2c, 0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x69,
+  0x74, 0x79, 0x5f, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x73, 0x2e, 0x7a, 0x2c,
+  0x20, 0x74, 0x69, 0x6c, 0x65, 0x29, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20,
+  0x66, 0x6f, 0x72, 0x20, 0x28, 0x69, 0x6e, 0x74, 0x20, 0x64, 0x79, 0x20,
+  0x3d, 0x20, 0x2d, 0x31, 0x3b, 0x20, 0x64, 0x79, 0x20, 0x3c, 0x3d, 0x20,
+  0x31, 0x20, 0x26, 0x26, 0x20, 0x21, 0x6c, 0x69, 0x73, 0x74, 0x65, 0x64,
+  0x3b, 0x20, 0x64, 0x79, 0x2b, 0x2b, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x66, 0x6f, 0x72, 0x20, 0x28, 0x69,
+  0x6e, 0x74, 0x20, 0x64, 0x78, 0x20, 0x3d, 0x20, 0x2d, 0x31, 0x3b, 0x20,
+  0x64, 0x78, 0x20, 0x3c, 0x3d, 0x20, 0x31, 0x20, 0x26, 0x26, 0x20, 0x21,
+  0x6c, 0x69, 0x73, 0x74, 0x65, 0x64, 0x3b, 0x20, 0x64, 0x78, 0x2b, 0x2b,
+  0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x69, 0x76, 0x65, 0x63, 0x32, 0x20, 0x6e, 0x65,
+  0x69, 0x67, 0x68, 0x62, 0x6f, 0x75, 0x72, 0x20, 0x3d, 0x20, 0x74, 0x69,
+  0x6c, 0x65, 0x20, 0x2b, 0x20, 0x69, 0x76, 0x65, 0x63, 0x32, 0x28, 0x64,
+  0x78, 0x2c, 0x20, 0x64, 0x79, 0x29, 0x3b, 0x0a, 0x23, 0x69, 0x66, 0x20,
+  0x54, 0x4f, 0x52, 0x4f, 0x49, 0x44, 0x41, 0x4c, 0x0a, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x6e, 0x65, 0x69,
+  0x67, 0x68, 0x62, 0x6f, 0x75, 0x72, 0x20, 0x3d, 0x20, 0x28, 0x6e, 0x65,
+  0x69, 0x67, 0x68, 0x62, 0x6f, 0x75, 0x72, 0x20, 0x2b, 0x20, 0x74, 0x69,
+  0x6c, 0x65, 0x73, 0x50, 0x65, 0x72, 0x52, 0x6f, 0x77, 0x29, 0x20, 0x25,
+  0x20, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x50, 0x65, 0x72, 0x52, 0x6f, 0x77,
+  0x3b, 0x0a, 0x23, 0x65, 0x6c, 0x73, 0x65, 0x0a, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x69, 0x66, 0x20, 0x28,
+  0x61, 0x6e, 0x79, 0x28, 0x6c, 0x65, 0x73, 0x73, 0x54, 0x68, 0x61, 0x6e,
+  0x28, 0x6e, 0x65, 0x69, 0x67, 0x68, 0x62, 0x6f, 0x75, 0x72, 0x2c, 0x20,
+  0x69, 0x76, 0x65, 0x63, 0x32, 0x28, 0x30, 0x29, 0x29, 0x29, 0x20, 0x7c,
+  0x7c, 0x20, 0x61, 0x6e, 0x79, 0x28, 0x67, 0x72, 0x65, 0x61, 0x74, 0x65,
+  0x72, 0x54, 0x68, 0x61, 0x6e, 0x45, 0x71, 0x75, 0x61, 0x6c, 0x28, 0x6e,
+  0x65, 0x69, 0x67, 0x68, 0x62, 0x6f, 0x75, 0x72, 0x2c, 0x20, 0x69, 0x76,
+  0x65, 0x63, 0x32, 0x28, 0x74, 0x69, 0x6c, 0x65, 0x73, 0x50, 0x65, 0x72,
+  0x52, 0x6f, 0x77, 0x29, 0x29, 0x29, 0x29, 0x20, 0x63, 0x6f, 0x6e, 0x74,
+  0x69, 0x6e, 0x75, 0x65, 0x3b, 0x0a, 0x23, 0x65, 0x6e, 0x64, 0x69, 0x66,
+  0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x6c, 0x69, 0x73, 0x74, 0x65, 0x64, 0x20, 0x3d, 0x20, 0x74, 0x69,
+  0x6c, 0x65, 0x4c, 0x69, 0x76, 0x65, 0x28, 0x61, 0x63, 0x74, 0x69, 0x76,
+  0x69, 0x74, 0x79, 0x5f, 0x73, 0x6c, 0x6f, 0x74, 0x73, 0x2e, 0x78, 0x2c,
+  0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x69, 0x74, 0x79, 0x5f, 0x73, 0x74,
+  0x61, 0x6d, 0x70, 0x73, 0x2e, 0x78, 0x2c, 0x20, 0x6e, 0x65, 0x69, 0x67,
+  0x68, 0x62, 0x6f, 0x75, 0x72, 0x29, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a,
+  0x0a, 0x20, 0x20, 0x20, 0x20, 0x69, 0x66, 0x20, 0x28, 0x6c, 0x69, 0x73,
+  0x74, 0x65, 0x64, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65, 0x5f, 0x74, 0x69,
+  0x6c, 0x65, 0x73, 0x5b, 0x61, 0x74, 0x6f, 0x6d, 0x69, 0x63, 0x41, 0x64,
+  0x64, 0x28, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65, 0x43, 0x6f, 0x75, 0x6e,
+  0x74, 0x2c, 0x20, 0x31, 0x75, 0x29, 0x5d, 0x20, 0x3d, 0x20, 0x75, 0x69,
+  0x6e, 0x74, 0x28, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x29, 0x3b, 0x0a, 0x20,
+  0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x6d, 0x65, 0x6d,
+  0x6f, 0x72, 0x79, 0x42, 0x61, 0x72, 0x72, 0x69, 0x65, 0x72, 0x53, 0x68,
+  0x61, 0x72, 0x65, 0x64, 0x28, 0x29, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20,
+  0x62, 0x61, 0x72, 0x72, 0x69, 0x65, 0x72, 0x28, 0x29, 0x3b, 0x0a, 0x0a,
+  0x20, 0x20, 0x20, 0x20, 0x69, 0x66, 0x20, 0x28, 0x69, 0x6e, 0x64, 0x65,
+  0x78, 0x20, 0x3d, 0x3d, 0x20, 0x30, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x64, 0x69, 0x73, 0x70, 0x61, 0x74,
+  0x63, 0x68, 0x5f, 0x73, 0x69, 0x7a, 0x65, 0x5b, 0x30, 0x5d, 0x20, 0x3d,
+  0x20, 0x61, 0x63, 0x74, 0x69, 0x76, 0x65, 0x43, 0x6f, 0x75, 0x6e, 0x74,
+  0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x64, 0x69,
+  0x73, 0x70, 0x61, 0x74, 0x63, 0x68, 0x5f, 0x73, 0x69, 0x7a, 0x65, 0x5b,
+  0x31, 0x5d, 0x20, 0x3d, 0x20, 0x31, 0x75, 0x3b, 0x0a, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x64, 0x69, 0x73, 0x70, 0x61, 0x74, 0x63,
+  0x68, 0x5f, 0x73, 0x69, 0x7a, 0x65, 0x5b, 0x32, 0x5d, 0x20, 0x3d, 0x20,
+  0x31, 0x75, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x7d, 0x0a
+};
+unsigned int gol_activity_glsl_len = 2364;
@@ -5,16 +5,49 @@ layout(std430, binding = 0) buffer PrevState { int prev_grid[]; };  // S(t-1)
 layout(std430, binding = 1) buffer CurrentState { int current_grid[]; }; // S(t)
 layout(std430, binding = 2) buffer NextState { int next_grid[]; }; // S(t+1)
 
+// With activity tracking, workgroups only run for the 16x16 tiles listed by
+// gol_activity, and stamp the flags of the tiles where they leave a live cell
+layout(std430, binding = 4) buffer Activity { uint tile_active[]; };
+layout(std430, binding = 5) buffer ActiveTiles { uint dispatch_size[3]; uint active_tiles[]; };
+layout(location = 0) uniform int activity_slot;     // Buffer of S(t+1)
+layout(location = 1) uniform uint activity_stamp;   // Its new stamp
+
+// Specialised at load time: the rule as neighbour-count bit masks (bit n set when
+// n live neighbours give a live cell) and the grid topology
+#ifndef BIRTH_MASK
+#define BIRTH_MASK 8        // B3
+#endif
+#ifndef SURVIVE_MASK
+#define SURVIVE_MASK 12     // S23
+#endif
+#ifndef TOROIDAL
+#define TOROIDAL 0
+#endif
+#ifndef TRACK_ACTIVITY
+#define TRACK_ACTIVITY 0
+#endif
+
 const int gridSize = 256;
+const int tilesPerRow = gridSize / 16;
 
 int getCell(int x, int y) {
+#if TOROIDAL
+    return current_grid[((y + gridSize) % gridSize) * gridSize + (x + gridSize) % gridSize];
+#else
     if (x < 0 || x >= gridSize || y < 0 || y >= gridSize) return 0;
     return current_grid[y * gridSize + x];
+#endif
 }
 
 void main() {
+#if TRACK_ACTIVITY
+    int tile = int(active_tiles[gl_WorkGroupID.x]);
+    int x = (tile % tilesPerRow) * 16 + int(gl_LocalInvocationID.x);
+    int y = (tile / tilesPerRow) * 16 + int(gl_LocalInvocationID.y);
+#else
     int x = int(gl_GlobalInvocationID.x);
     int y = int(gl_GlobalInvocationID.y);
+#endif
     if (x >= gridSize || y >= gridSize) return;
 
     int index = y * gridSize + x;
@@ -29,10 +62,15 @@ void main() {
                   + getCell(x, y+1)
                   + getCell(x+1, y+1);
 
-    // Game of Life rules
-    int newState = (current_grid[index] == 1) ?
-    ((neighbors == 2 || neighbors == 3) ? 1 : 0) :
-    ((neighbors == 3) ? 1 : 0);
+    // Outer totalistic rule (Game of Life by default)
+    int rule = (current_grid[index] == 1) ? SURVIVE_MASK : BIRTH_MASK;
+    int newState = (rule >> neighbors) & 1;
+
+    int nextState = newState ^ prev_grid[index];
+    next_grid[index] = nextState;
 
-    next_grid[index] = newState ^ prev_grid[index];
+#if TRACK_ACTIVITY
+    // Every live cell of the tile stores the same value
+    if (nextState != 0) tile_active[activity_slot * tilesPerRow * tilesPerRow + tile] = activity_stamp;
+#endif
 }
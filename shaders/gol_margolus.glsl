@@ -0,0 +1,55 @@
+#version 430 core
+
+// One invocation per 2x2 block of the Margolus partition selected by `phase`
+// (0: blocks start at even rows and columns, 1: at odd ones)
+layout (local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+layout(std430, binding = 1) buffer CurrentState { int current_grid[]; }; // S(t)
+layout(std430, binding = 2) buffer NextState { int next_grid[]; }; // S(t+1)
+
+// Specialised at load time: the block table (forward or inverse) and the grid
+// topology. Block bits: 1 = top left, 2 = top right, 4 = bottom left, 8 = bottom right
+#ifndef BLOCK_TABLE
+#define BLOCK_TABLE 15, 14, 13, 3, 11, 5, 6, 1, 7, 9, 10, 2, 12, 4, 8, 0   // Critters
+#endif
+#ifndef TOROIDAL
+#define TOROIDAL 0
+#endif
+
+const int gridSize = 256;
+const int blockTable[16] = int[16](BLOCK_TABLE);
+
+layout(location = 0) uniform int phase;
+
+void main() {
+    int x0 = int(gl_GlobalInvocationID.x) * 2 + phase;
+    int y0 = int(gl_GlobalInvocationID.y) * 2 + phase;
+    if (x0 >= gridSize || y0 >= gridSize) return;
+
+    int x1 = (x0 + 1) % gridSize;
+    int y1 = (y0 + 1) % gridSize;
+
+    int topLeft = y0 * gridSize + x0;
+    int topRight = y0 * gridSize + x1;
+    int bottomLeft = y1 * gridSize + x0;
+    int bottomRight = y1 * gridSize + x1;
+
+    int block = current_grid[topLeft] | current_grid[topRight] << 1
+              | current_grid[bottomLeft] << 2 | current_grid[bottomRight] << 3;
+
+#if !TOROIDAL
+    // Blocks wrapping around the grid do not exist with a dead border
+    if (x1 == 0 || y1 == 0) {
+        next_grid[topLeft] = block & 1;
+        next_grid[topRight] = block >> 1 & 1;
+        next_grid[bottomLeft] = block >> 2 & 1;
+        next_grid[bottomRight] = block >> 3 & 1;
+        return;
+    }
+#endif
+
+    int result = blockTable[block];
+    next_grid[topLeft] = result & 1;
+    next_grid[topRight] = result >> 1 & 1;
+    next_grid[bottomLeft] = result >> 2 & 1;
+    next_grid[bottomRight] = result >> 3 & 1;
+}
@@ -0,0 +1,43 @@
+#version 430 core
+
+// Population and diffusion statistics of one generation: live cells in S(t)
+// and cells that differ between S(t-1) and S(t). Each workgroup reduces its
+// counts in shared memory and adds them to the generation's slot atomically
+layout (local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+layout(std430, binding = 0) buffer PrevState { int prev_grid[]; };  // S(t-1)
+layout(std430, binding = 1) buffer CurrentState { int current_grid[]; }; // S(t)
+layout(std430, binding = 3) buffer Stats { uint stats[]; }; // (live, changed) per generation
+
+layout(location = 0) uniform int slot;
+
+const int cellsPerInvocation = 4;
+
+shared uvec2 partial[256];
+
+void main() {
+    uint local = gl_LocalInvocationIndex;
+    int base = int(gl_WorkGroupID.x) * 256 * cellsPerInvocation + int(local);
+
+    uvec2 counts = uvec2(0);
+    for (int k = 0; k < cellsPerInvocation; k++) {
+        int index = base + k * 256;
+        int cell = current_grid[index];
+        counts.x += uint(cell);
+        counts.y += uint(cell != prev_grid[index]);
+    }
+
+    partial[local] = counts;
+    barrier();
+
+    for (uint stride = 128; stride > 0; stride >>= 1) {
+        if (local < stride) {
+            partial[local] += partial[local + stride];
+        }
+        barrier();
+    }
+
+    if (local == 0) {
+        atomicAdd(stats[2 * slot], partial[0].x);
+        atomicAdd(stats[2 * slot + 1], partial[0].y);
+    }
+}
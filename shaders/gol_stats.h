@@ -0,0 +1,121 @@
+unsigned char gol_stats_glsl[] = {
+  0x23, 0x76, 0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x34, 0x33, 0x30,
+  0x20, 0x63, 0x6f, 0x72, 0x65, 0x0a, 0x0a, 0x2f, 0x2f, 0x20, 0x50, 0x6f,
+  0x70, 0x75, 0x6c, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20, 0x61, 0x6e, 0x64,
+  0x20, 0x64, 0x69, 0x66, 0x66, 0x75, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x73,
+  0x74, 0x61, 0x74, 0x69, 0x73, 0x74, 0x69, 0x63, 0x73, 0x20, 0x6f, 0x66,
+  0x20, 0x6f, 0x6e, 0x65, 0x20, 0x67, 0x65, 0x6e, 0x65, 0x72, 0x61, 0x74,
+  0x69, 0x6f, 0x6e, 0x3a, 0x20, 0x6c, 0x69, 0x76, 0x65, 0x20, 0x63, 0x65,
+  0x6c, 0x6c, 0x73, 0x20, 0x69, 0x6e, 0x20, 0x53, 0x28, 0x74, 0x29, 0x0a,
+  0x2f, 0x2f, 0x20, 0x61, 0x6e, 0x64, 0x20, 0x63, 0x65, 0x6c, 0x6c, 0x73,
+  0x20, 0x74, 0x68, 0x61, 0x74, 0x20, 0x64, 0x69, 0x66, 0x66, 0x65, 0x72,
+  0x20, 0x62, 0x65, 0x74, 0x77, 0x65, 0x65, 0x6e, 0x20, 0x53, 0x28, 0x74,
+  0x2d, 0x31, 0x29, 0x20, 0x61, 0x6e, 0x64, 0x20, 0x53, 0x28, 0x74, 0x29,
+  0x2e, 0x20, 0x45, 0x61, 0x63, 0x68, 0x20, 0x77, 0x6f, 0x72, 0x6b, 0x67,
+  0x72, 0x6f, 0x75, 0x70, 0x20, 0x72, 0x65, 0x64, 0x75, 0x63, 0x65, 0x73,
+  0x20, 0x69, 0x74, 0x73, 0x0a, 0x2f, 0x2f, 0x20, 0x63, 0x6f, 0x75, 0x6e,
+  0x74, 0x73, 0x20, 0x69, 0x6e, 0x20, 0x73, 0x68, 0x61, 0x72, 0x65, 0x64,
+  0x20, 0x6d, 0x65, 0x6d, 0x6f, 0x72, 0x79, 0x20, 0x61, 0x6e, 0x64, 0x20,
+  0x61, 0x64, 0x64, 0x73, 0x20, 0x74, 0x68, 0x65, 0x6d, 0x20, 0x74, 0x6f,
+  0x20, 0x74, 0x68, 0x65, 0x20, 0x67, 0x65, 0x6e, 0x65, 0x72, 0x61, 0x74,
+  0x69, 0x6f, 0x6e, 0x27, 0x73, 0x20, 0x73, 0x6c, 0x6f, 0x74, 0x20, 0x61,
+  0x74, 0x6f, 0x6d, 0x69, 0x63, 0x61, 0x6c, 0x6c, 0x79, 0x0a, 0x6c, 0x61,
+  0x79, 0x6f, 0x75, 0x74, 0x20, 0x28, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x5f,
+  0x73, 0x69, 0x7a, 0x65, 0x5f, 0x78, 0x20, 0x3d, 0x20, 0x32, 0x35, 0x36,
+  0x2c, 0x20, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x5f, 0x73, 0x69, 0x7a, 0x65,
+  0x5f, 0x79, 0x20, 0x3d, 0x20, 0x31, 0x2c, 0x20, 0x6c, 0x6f, 0x63, 0x61,
+  0x6c, 0x5f, 0x73, 0x69, 0x7a, 0x65, 0x5f, 0x7a, 0x20, 0x3d, 0x20, 0x31,
+  0x29, 0x20, 0x69, 0x6e, 0x3b, 0x0a, 0x6c, 0x61, 0x79, 0x6f, 0x75, 0x74,
+  0x28, 0x73, 0x74, 0x64, 0x34, 0x33, 0x30, 0x2c, 0x20, 0x62, 0x69, 0x6e,
+  0x64, 0x69, 0x6e, 0x67, 0x20, 0x3d, 0x20, 0x30, 0x29, 0x20, 0x62, 0x75,
+  0x66, 0x66, 0x65, 0x72, 0x20, 0x50, 0x72, 0x65, 0x76, 0x53, 0x74, 0x61,
+  0x74, 0x65, 0x20, 0x7b, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x70, 0x72, 0x65,
+  0x76, 0x5f, 0x67, 0x72, 0x69, 0x64, 0x5b, 0x5d, 0x3b, 0x20, 0x7d, 0x3b,
+  0x20, 0x20, 0x2f, 0x2f, 0x20, 0x53, 0x28, 0x74, 0x2d, 0x31, 0x29, 0x0a,
+  0x6c, 0x61, 0x79, 0x6f, 0x75, 0x74, 0x28, 0x73, 0x74, 0x64, 0x34, 0x33,
+  0x30, 0x2c, 0x20, 0x62, 0x69, 0x6e, 0x64, 0x69, 0x6e, 0x67, 0x20, 0x3d,
+  0x20, 0x31, 0x29, 0x20, 0x62, 0x75, 0x66, 0x66, 0x65, 0x72, 0x20, 0x43,
+  0x75, 0x72, 0x72, 0x65, 0x6e, 0x74, 0x53, 0x74, 0x61, 0x74, 0x65, 0x20,
+  0x7b, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x63, 0x75, 0x72, 0x72, 0x65, 0x6e,
+  0x74, 0x5f, 0x67, 0x72, 0x69, 0x64, 0x5b, 0x5d, 0x3b, 0x20, 0x7d, 0x3b,
+  0x20, 0x2f, 0x2f, 0x20, 0x53, 0x28, 0x74, 0x29, 0x0a, 0x6c, 0x61, 0x79,
+  0x6f, 0x75, 0x74, 0x28, 0x73, 0x74, 0x64, 0x34, 0x33, 0x30, 0x2c, 0x20,
+  0x62, 0x69, 0x6e, 0x64, 0x69, 0x6e, 0x67, 0x20, 0x3d, 0x20, 0x33, 0x29,
+  0x20, 0x62, 0x75, 0x66, 0x66, 0x65, 0x72, 0x20, 0x53, 0x74, 0x61, 0x74,
+  0x73, 0x20, 0x7b, 0x20, 0x75, 0x69, 0x6e, 0x74, 0x20, 0x73, 0x74, 0x61,
+  0x74, 0x73, 0x5b, 0x5d, 0x3b, 0x20, 0x7d, 0x3b, 0x20, 0x2f, 0x2f, 0x20,
+  0x28, 0x6c, 0x69, 0x76, 0x65, 0x2c, 0x20, 0x63, 0x68, 0x61, 0x6e, 0x67,
+  0x65, 0x64, 0x29, 0x20, 0x70, 0x65, 0x72, 0x20, 0x67, 0x65, 0x6e, 0x65,
+  0x72, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x0a, 0x0a, 0x6c, 0x61, 0x79, 0x6f,
+  0x75, 0x74, 0x28, 0x6c, 0x6f, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x20,
+  0x3d, 0x20, 0x30, 0x29, 0x20, 0x75, 0x6e, 0x69, 0x66, 0x6f, 0x72, 0x6d,
+  0x20, 0x69, 0x6e, 0x74, 0x20, 0x73, 0x6c, 0x6f, 0x74, 0x3b, 0x0a, 0x0a,
+  0x63, 0x6f, 0x6e, 0x73, 0x74, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x63, 0x65,
+  0x6c, 0x6c, 0x73, 0x50, 0x65, 0x72, 0x49, 0x6e, 0x76, 0x6f, 0x63, 0x61,
+  0x74, 0x69, 0x6f, 0x6e, 0x20, 0x3d, 0x20, 0x34, 0x3b, 0x0a, 0x0a, 0x73,
+  0x68, 0x61, 0x72, 0x65, 0x64, 0x20, 0x75, 0x76, 0x65, 0x63, 0x32, 0x20,
+  0x70, 0x61, 0x72, 0x74, 0x69, 0x61, 0x6c, 0x5b, 0x32, 0x35, 0x36, 0x5d,
+  0x3b, 0x0a, 0x0a, 0x76, 0x6f, 0x69, 0x64, 0x20, 0x6d, 0x61, 0x69, 0x6e,
+  0x28, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x75, 0x69, 0x6e,
+  0x74, 0x20, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x20, 0x3d, 0x20, 0x67, 0x6c,
+  0x5f, 0x4c, 0x6f, 0x63, 0x61, 0x6c, 0x49, 0x6e, 0x76, 0x6f, 0x63, 0x61,
+  0x74, 0x69, 0x6f, 0x6e, 0x49, 0x6e, 0x64, 0x65, 0x78, 0x3b, 0x0a, 0x20,
+  0x20, 0x20, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x62, 0x61, 0x73, 0x65, 0x20,
+  0x3d, 0x20, 0x69, 0x6e, 0x74, 0x28, 0x67, 0x6c, 0x5f, 0x57, 0x6f, 0x72,
+  0x6b, 0x47, 0x72, 0x6f, 0x75, 0x70, 0x49, 0x44, 0x2e, 0x78, 0x29, 0x20,
+  0x2a, 0x20, 0x32, 0x35, 0x36, 0x20, 0x2a, 0x20, 0x63, 0x65, 0x6c, 0x6c,
+  0x73, 0x50, 0x65, 0x72, 0x49, 0x6e, 0x76, 0x6f, 0x63, 0x61, 0x74, 0x69,
+  0x6f, 0x6e, 0x20, 0x2b, 0x20, 0x69, 0x6e, 0x74, 0x28, 0x6c, 0x6f, 0x63,
+  0x61, 0x6c, 0x29, 0x3b, 0x0a, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x75, 0x76,
+  0x65, 0x63, 0x32, 0x20, 0x63, 0x6f, 0x75, 0x6e, 0x74, 0x73, 0x20, 0x3d,
+  0x20, 0x75, 0x76, 0x65, 0x63, 0x32, 0x28, 0x30, 0x29, 0x3b, 0x0a, 0x20,
+  0x20, 0x20, 0x20, 0x66, 0x6f, 0x72, 0x20, 0x28, 0x69, 0x6e, 0x74, 0x20,
+  0x6b, 0x20, 0x3d, 0x20, 0x30, 0x3b, 0x20, 0x6b, 0x20, 0x3c, 0x20, 0x63,
+  0x65, 0x6c, 0x6c, 0x73, 0x50, 0x65, 0x72, 0x49, 0x6e, 0x76, 0x6f, 0x63,
+  0x61, 0x74, 0x69, 0x6f, 0x6e, 0x3b, 0x20, 0x6b, 0x2b, 0x2b, 0x29, 0x20,
+  0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x69, 0x6e,
+  0x74, 0x20, 0x69, 0x6e, 0x64, 0x65, 0x78, 0x20, 0x3d, 0x20, 0x62, 0x61,
+  0x73, 0x65, 0x20, 0x2b, 0x20, 0x6b, 0x20, 0x2a, 0x20, 0x32, 0x35, 0x36,
+  0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x69, 0x6e,
+  0x74, 0x20, 0x63, 0x65, 0x6c, 0x6c, 0x20, 0x3d, 0x20, 0x63, 0x75, 0x72,
+  0x72, 0x65, 0x6e, 0x74, 0x5f, 0x67, 0x72, 0x69, 0x64, 0x5b, 0x69, 0x6e,
+  0x64, 0x65, 0x78, 0x5d, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x63, 0x6f, 0x75, 0x6e, 0x74, 0x73, 0x2e, 0x78, 0x20, 0x2b,
+  0x3d, 0x20, 0x75, 0x69, 0x6e, 0x74, 0x28, 0x63, 0x65, 0x6c, 0x6c, 0x29,
+  0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x63, 0x6f,
+  0x75, 0x6e, 0x74, 0x73, 0x2e, 0x79, 0x20, 0x2b, 0x3d, 0x20, 0x75, 0x69,
+  0x6e, 0x74, 0x28, 0x63, 0x65, 0x6c, 0x6c, 0x20, 0x21, 0x3d, 0x20, 0x70,
+  0x72, 0x65, 0x76, 0x5f, 0x67, 0x72, 0x69, 0x64, 0x5b, 0x69, 0x6e, 0x64,
+  0x65, 0x78, 0x5d, 0x29, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a,
+  0x0a, 0x20, 0x20, 0x20, 0x20, 0x70, 0x61, 0x72, 0x74, 0x69, 0x61, 0x6c,
+  0x5b, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x5d, 0x20, 0x3d, 0x20, 0x63, 0x6f,
+  0x75, 0x6e, 0x74, 0x73, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x62, 0x61,
+  0x72, 0x72, 0x69, 0x65, 0x72, 0x28, 0x29, 0x3b, 0x0a, 0x0a, 0x20, 0x20,
+  0x20, 0x20, 0x66, 0x6f, 0x72, 0x20, 0x28, 0x75, 0x69, 0x6e, 0x74, 0x20,
+  0x73, 0x74, 0x72, 0x69, 0x64, 0x65, 0x20, 0x3d, 0x20, 0x31, 0x32, 0x38,
+  0x3b, 0x20, 0x73, 0x74, 0x72, 0x69, 0x64, 0x65, 0x20, 0x3e, 0x20, 0x30,
+  0x3b, 0x20, 0x73, 0x74, 0x72, 0x69, 0x64, 0x65, 0x20, 0x3e, 0x3e, 0x3d,
+  0x20, 0x31, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x69, 0x66, 0x20, 0x28, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x20,
+  0x3c, 0x20, 0x73, 0x74, 0x72, 0x69, 0x64, 0x65, 0x29, 0x20, 0x7b, 0x0a,
+  0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x70, 0x61, 0x72, 0x74, 0x69, 0x61, 0x6c, 0x5b, 0x6c, 0x6f, 0x63, 0x61,
+  0x6c, 0x5d, 0x20, 0x2b, 0x3d, 0x20, 0x70, 0x61, 0x72, 0x74, 0x69, 0x61,
+  0x6c, 0x5b, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x20, 0x2b, 0x20, 0x73, 0x74,
+  0x72, 0x69, 0x64, 0x65, 0x5d, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x7d, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x62, 0x61, 0x72, 0x72, 0x69, 0x65, 0x72, 0x28, 0x29, 0x3b, 0x0a,
+  0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x69,
+  0x66, 0x20, 0x28, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x20, 0x3d, 0x3d, 0x20,
+  0x30, 0x29, 0x20, 0x7b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x61, 0x74, 0x6f, 0x6d, 0x69, 0x63, 0x41, 0x64, 0x64, 0x28, 0x73,
+  0x74, 0x61, 0x74, 0x73, 0x5b, 0x32, 0x20, 0x2a, 0x20, 0x73, 0x6c, 0x6f,
+  0x74, 0x5d, 0x2c, 0x20, 0x70, 0x61, 0x72, 0x74, 0x69, 0x61, 0x6c, 0x5b,
+  0x30, 0x5d, 0x2e, 0x78, 0x29, 0x3b, 0x0a, 0x20, 0x20, 0x20, 0x20, 0x20,
+  0x20, 0x20, 0x20, 0x61, 0x74, 0x6f, 0x6d, 0x69, 0x63, 0x41, 0x64, 0x64,
+  0x28, 0x73, 0x74, 0x61, 0x74, 0x73, 0x5b, 0x32, 0x20, 0x2a, 0x20, 0x73,
+  0x6c, 0x6f, 0x74, 0x20, 0x2b, 0x20, 0x31, 0x5d, 0x2c, 0x20, 0x70, 0x61,
+  0x72, 0x74, 0x69, 0x61, 0x6c, 0x5b, 0x30, 0x5d, 0x2e, 0x79, 0x29, 0x3b,
+  0x0a, 0x20, 0x20, 0x20, 0x20, 0x7d, 0x0a, 0x7d, 0x0a
+};
+unsigned int gol_stats_glsl_len = 1413;
@@ -0,0 +1,649 @@
+#include "CPUCellularAutomaton.h"
+#include "SnapshotChannel.h"
+#include <algorithm>
+
+namespace {
+    constexpr int ROW_WORDS = SIDE / 64;
+    constexpr AutomatonRule CONWAY{};
+
+    // a + b + c as (sum, carry)
+    inline void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t &sum, uint64_t &carry) {
+        uint64_t ab = a ^ b;
+        sum = ab ^ c;
+        carry = (a & b) | (ab & c);
+    }
+
+    // Cells whose neighbour count (bits b0..b3) equals n
+    inline uint64_t countIs(int n, uint64_t b0, uint64_t b1, uint64_t b2, uint64_t b3) {
+        return (n & 1 ? b0 : ~b0) & (n & 2 ? b1 : ~b1) & (n & 4 ? b2 : ~b2) & (n & 8 ? b3 : ~b3);
+    }
+
+    constexpr uint64_t DEAD_ROW[ROW_WORDS] = {};
+
+    // Row y of a grid of `rows` rows, wrapping around or dead beyond the edges
+    template<bool TOROIDAL>
+    inline const uint64_t *rowAt(const uint64_t *grid, int rows, int y) {
+        if (y < 0 || y >= rows) {
+            return TOROIDAL ? grid + ((y + rows) % rows) * ROW_WORDS : DEAD_ROW;
+        }
+        return grid + y * ROW_WORDS;
+    }
+
+    template<bool TOROIDAL, bool CONWAY_RULE>
+    void stepKernel(const uint64_t *source, const uint64_t *other, uint64_t *out, int rows, int first, int last,
+                    const CPUCellularAutomaton::MooreTables &rule) {
+        for (int y = first; y < last; y++) {
+            const uint64_t *neighbourRows[3];
+            for (int dy = -1; dy <= 1; dy++) {
+                neighbourRows[dy + 1] = rowAt<TOROIDAL>(source, rows, y + dy);
+            }
+
+            for (int k = 0; k < ROW_WORDS; k++) {
+                // West and east neighbour planes of each row: bit x holds cell x - 1 (resp. x + 1)
+                uint64_t west[3], centre[3], east[3];
+                for (int r = 0; r < 3; r++) {
+                    const uint64_t *row = neighbourRows[r];
+                    uint64_t left = k > 0 ? row[k - 1] : (TOROIDAL ? row[ROW_WORDS - 1] : 0);
+                    uint64_t right = k < ROW_WORDS - 1 ? row[k + 1] : (TOROIDAL ? row[0] : 0);
+                    centre[r] = row[k];
+                    west[r] = (row[k] << 1) | (left >> 63);
+                    east[r] = (row[k] >> 1) | (right << 63);
+                }
+
+                // Carry-save sum of the eight neighbours into count bits b0..b3
+                uint64_t sumA, carryA, sumB, carryB, sumC, carryC;
+                fullAdd(west[0], centre[0], east[0], sumA, carryA);
+                fullAdd(west[1], east[1], west[2], sumB, carryB);
+                sumC = centre[2] ^ east[2];
+                carryC = centre[2] & east[2];
+
+                uint64_t b0, twos, twosSum, fours, b1, foursCarry;
+                fullAdd(sumA, sumB, sumC, b0, twos);
+                fullAdd(carryA, carryB, carryC, twosSum, fours);
+                b1 = twosSum ^ twos;
+                foursCarry = twosSum & twos;
+                uint64_t b2 = fours ^ foursCarry;
+                uint64_t b3 = fours & foursCarry;
+
+                const uint64_t alive = centre[1];
+                uint64_t next;
+                if constexpr (CONWAY_RULE) {
+                    // Two or three neighbours: b1 set, b2 and b3 clear; three also gives birth
+                    next = b1 & ~b2 & ~b3 & (b0 | alive);
+                } else {
+                    next = 0;
+                    for (int n = 0; n <= 8; n++) {
+                        uint64_t allowed = (alive & rule.survive[n]) | (~alive & rule.birth[n]);
+                        if (allowed) {
+                            next |= countIs(n, b0, b1, b2, b3) & allowed;
+                        }
+                    }
+                }
+
+                out[y * ROW_WORDS + k] = next ^ other[y * ROW_WORDS + k];
+            }
+        }
+    }
+
+    // Word k of a row with one cell of margin on each side, as a 66-bit stream split
+    // into `low` (bit j = cell 64k - 1 + j) and `high` (its last two bits)
+    template<bool TOROIDAL>
+    inline void paddedWindow(const uint64_t *row, int k, uint64_t &low, uint64_t &high) {
+        uint64_t left = k > 0 ? row[k - 1] : (TOROIDAL ? row[ROW_WORDS - 1] : 0);
+        uint64_t right = k < ROW_WORDS - 1 ? row[k + 1] : (TOROIDAL ? row[0] : 0);
+        low = (row[k] << 1) | (left >> 63);
+        high = (row[k] >> 63) | (right << 1);
+    }
+
+    // Needs at least two rows to compute: an odd last row is computed along with
+    // the one above it, a second time
+    template<bool TOROIDAL>
+    void lookupKernel(const uint64_t *source, const uint64_t *other, uint64_t *out, int rows, int first, int last,
+                      const CPUCellularAutomaton::MooreTables &rule) {
+        const uint8_t *lookup = rule.lookup.data();
+
+        // Each step produces the 2x2 cells of rows y, y + 1 from rows y - 1 .. y + 2
+        for (int pair = first; pair < last; pair += 2) {
+            const int y = std::min(pair, last - 2);
+            const uint64_t *neighbourRows[4];
+            for (int r = 0; r < 4; r++) {
+                neighbourRows[r] = rowAt<TOROIDAL>(source, rows, y - 1 + r);
+            }
+
+            for (int k = 0; k < ROW_WORDS; k++) {
+                uint64_t low[4], high[4];
+                for (int r = 0; r < 4; r++) {
+                    paddedWindow<TOROIDAL>(neighbourRows[r], k, low[r], high[r]);
+                }
+
+                uint64_t top = 0, bottom = 0;
+                for (int x = 0; x < 64; x += 2) {
+                    int index = 0;
+                    for (int r = 0; r < 4; r++) {
+                        uint64_t window = x < 62 ? low[r] >> x : (low[r] >> 62) | (high[r] << 2);
+                        index |= static_cast<int>(window & 0xF) << (4 * r);
+                    }
+
+                    const uint64_t cells = lookup[index];
+                    top |= (cells & 3) << x;
+                    bottom |= (cells >> 2) << x;
+                }
+
+                out[y * ROW_WORDS + k] = top ^ other[y * ROW_WORDS + k];
+                out[(y + 1) * ROW_WORDS + k] = bottom ^ other[(y + 1) * ROW_WORDS + k];
+            }
+        }
+    }
+
+    // Builds the lookup kernel's table: bit 0..3 of an entry are the next states of
+    // the centre cells (1, 1), (1, 2), (2, 1), (2, 2) of the 4x4 neighbourhood
+    std::vector<uint8_t> buildNeighbourhoodTable(const AutomatonRule &rule) {
+        std::vector<uint8_t> table(1 << 16);
+        for (int index = 0; index < 1 << 16; index++) {
+            auto cell = [index](int row, int column) { return (index >> (4 * row + column)) & 1; };
+
+            uint8_t cells = 0;
+            for (int centre = 0; centre < 4; centre++) {
+                int row = 1 + centre / 2, column = 1 + centre % 2;
+                int neighbours = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        if (dy != 0 || dx != 0) {
+                            neighbours += cell(row + dy, column + dx);
+                        }
+                    }
+                }
+
+                uint16_t mask = cell(row, column) ? rule.survive : rule.birth;
+                cells |= ((mask >> neighbours) & 1) << centre;
+            }
+            table[index] = cells;
+        }
+        return table;
+    }
+
+    // Applies a block table to 32 blocks at once: their left cells are the `lanes`
+    // bits of `top` and `bottom`, their right cells the bits just above. Blocks
+    // outside `lanes` are left unchanged
+    inline void applyBlocks(uint64_t &top, uint64_t &bottom, const CPUCellularAutomaton::BlockTables &tables,
+                            uint64_t lanes) {
+        const uint64_t topLeft = top & lanes, topRight = (top >> 1) & lanes;
+        const uint64_t bottomLeft = bottom & lanes, bottomRight = (bottom >> 1) & lanes;
+
+        uint64_t outTopLeft = 0, outTopRight = 0, outBottomLeft = 0, outBottomRight = 0;
+        for (int block = 0; block < 16; block++) {
+            uint64_t match = lanes & (block & 1 ? topLeft : ~topLeft) & (block & 2 ? topRight : ~topRight) &
+                             (block & 4 ? bottomLeft : ~bottomLeft) & (block & 8 ? bottomRight : ~bottomRight);
+            const int result = tables.blocks[block];
+            if (result & 1) outTopLeft |= match;
+            if (result & 2) outTopRight |= match;
+            if (result & 4) outBottomLeft |= match;
+            if (result & 8) outBottomRight |= match;
+        }
+
+        const uint64_t keep = ~(lanes | lanes << 1);
+        top = (top & keep) | outTopLeft | outTopRight << 1;
+        bottom = (bottom & keep) | outBottomLeft | outBottomRight << 1;
+    }
+
+    // Same with the pair table, two blocks per lookup
+    inline void lookupBlocks(uint64_t &top, uint64_t &bottom, const CPUCellularAutomaton::BlockTables &tables,
+                             uint64_t lanes) {
+        uint64_t newTop = 0, newBottom = 0;
+        for (int x = 0; x < 64; x += 4) {
+            const uint64_t pair = tables.pairs[(top >> x & 0xF) | (bottom >> x & 0xF) << 4];
+            newTop |= (pair & 0xF) << x;
+            newBottom |= (pair >> 4) << x;
+        }
+
+        const uint64_t blockBits = lanes | lanes << 1;
+        top = (top & ~blockBits) | (newTop & blockBits);
+        bottom = (bottom & ~blockBits) | (newBottom & blockBits);
+    }
+
+    CPUCellularAutomaton::BlockTables buildBlockTables(const BlockTable &blocks) {
+        CPUCellularAutomaton::BlockTables tables{};
+        tables.blocks = blocks;
+        for (int index = 0; index < 256; index++) {
+            int top = index & 0xF, bottom = index >> 4;
+            int left = blocks[(top & 3) | (bottom & 3) << 2];
+            int right = blocks[(top >> 2) | (bottom >> 2) << 2];
+            tables.pairs[index] = static_cast<uint8_t>((left & 3) | (right & 3) << 2 |
+                                                       (left >> 2) << 4 | (right >> 2) << 6);
+        }
+        return tables;
+    }
+
+    template<bool TOROIDAL, bool LOOKUP>
+    void blockKernel(PackedGrid &grid, const CPUCellularAutomaton::BlockTables &tables, int phase, int first,
+                     int last) {
+        constexpr uint64_t EVEN_LANES = 0x5555555555555555ULL;
+
+        for (int y = first + phase; y < last; y += 2) {
+            // With a dead border, the odd partition's wrapping blocks (last row with
+            // the first, last column with the first) do not exist and stay unchanged
+            int below = (y + 1) % SIDE;
+            if (!TOROIDAL && below == 0) {
+                break;
+            }
+
+            uint64_t *top = grid.data() + y * ROW_WORDS;
+            uint64_t *bottom = grid.data() + below * ROW_WORDS;
+
+            if (phase == 0) {
+                for (int k = 0; k < ROW_WORDS; k++) {
+                    LOOKUP ? lookupBlocks(top[k], bottom[k], tables, EVEN_LANES)
+                           : applyBlocks(top[k], bottom[k], tables, EVEN_LANES);
+                }
+                continue;
+            }
+
+            // Odd partition: shift the rows by one cell so blocks start at even bits
+            uint64_t shiftedTop[ROW_WORDS], shiftedBottom[ROW_WORDS];
+            for (int k = 0; k < ROW_WORDS; k++) {
+                shiftedTop[k] = (top[k] >> 1) | (top[(k + 1) % ROW_WORDS] << 63);
+                shiftedBottom[k] = (bottom[k] >> 1) | (bottom[(k + 1) % ROW_WORDS] << 63);
+            }
+            for (int k = 0; k < ROW_WORDS; k++) {
+                uint64_t lanes = !TOROIDAL && k == ROW_WORDS - 1 ? EVEN_LANES & ~(1ULL << 62) : EVEN_LANES;
+                LOOKUP ? lookupBlocks(shiftedTop[k], shiftedBottom[k], tables, lanes)
+                       : applyBlocks(shiftedTop[k], shiftedBottom[k], tables, lanes);
+            }
+            for (int k = 0; k < ROW_WORDS; k++) {
+                int left = (k + ROW_WORDS - 1) % ROW_WORDS;
+                top[k] = (shiftedTop[k] << 1) | (shiftedTop[left] >> 63);
+                bottom[k] = (shiftedBottom[k] << 1) | (shiftedBottom[left] >> 63);
+            }
+        }
+    }
+}
+
+CPUCellularAutomaton::CPUCellularAutomaton(const AutomatonRule &rule, CPUKernel kernel, unsigned int threads,
+                                           bool temporalBlocking)
+    : m_tiled(temporalBlocking) {
+    // Spinning threads must not share cores: more threads than cores only wait for each other
+    const unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min({threads == 0 ? cores : threads, cores, static_cast<unsigned int>(SIDE / MIN_BAND_ROWS)});
+
+    // Bands of whole activity bands, an even number of rows so Margolus blocks never
+    // straddle two of them
+    for (unsigned int t = 0; t < threads; t++) {
+        auto band = std::make_unique<Band>();
+        band->index = static_cast<int>(t);
+        band->first = static_cast<int>(SIDE / ACTIVITY_ROWS * t / threads) * ACTIVITY_ROWS;
+        band->last = static_cast<int>(SIDE / ACTIVITY_ROWS * (t + 1) / threads) * ACTIVITY_ROWS;
+        m_bands.push_back(std::move(band));
+    }
+    m_barrier = std::make_unique<SpinBarrier>(static_cast<int>(threads));
+    for (unsigned int t = 1; t < threads; t++) {
+        m_workers.emplace_back(&CPUCellularAutomaton::workerLoop, this, std::ref(*m_bands[t]));
+    }
+
+    const bool lookup = kernel == CPUKernel::Lookup;
+    const bool toroidal = rule.topology == Topology::Toroidal;
+    m_toroidal = toroidal;
+
+    if (rule.neighbourhood == Neighbourhood::Margolus) {
+        m_forwardBlocks = buildBlockTables(rule.blockTable());
+        m_backwardBlocks = buildBlockTables(rule.inverseBlockTable());
+        if (toroidal) {
+            m_blockKernel = lookup ? blockKernel<true, true> : blockKernel<true, false>;
+        } else {
+            m_blockKernel = lookup ? blockKernel<false, true> : blockKernel<false, false>;
+        }
+        return;
+    }
+
+    // A dead neighbourhood stays dead unless dead cells with no live neighbour are born
+    m_trackActivity = !(rule.birth & 1);
+
+    if (lookup) {
+        m_rule.lookup = buildNeighbourhoodTable(rule);
+        m_kernel = toroidal ? lookupKernel<true> : lookupKernel<false>;
+        return;
+    }
+
+    for (int n = 0; n <= 8; n++) {
+        m_rule.birth[n] = (rule.birth >> n) & 1 ? ~0ULL : 0;
+        m_rule.survive[n] = (rule.survive >> n) & 1 ? ~0ULL : 0;
+    }
+
+    const bool conway = rule.birth == CONWAY.birth && rule.survive == CONWAY.survive;
+    if (toroidal) {
+        m_kernel = conway ? stepKernel<true, true> : stepKernel<true, false>;
+    } else {
+        m_kernel = conway ? stepKernel<false, true> : stepKernel<false, false>;
+    }
+}
+
+CPUCellularAutomaton::~CPUCellularAutomaton() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_epoch.fetch_add(1, std::memory_order_release);
+    }
+    m_wakeup.notify_all();
+
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void CPUCellularAutomaton::runForward() {
+    run(1, false);
+}
+
+void CPUCellularAutomaton::runBackward() {
+    run(1, true);
+}
+
+void CPUCellularAutomaton::runForwardBy(int generations) {
+    run(generations, false);
+}
+
+void CPUCellularAutomaton::runBackwardBy(int generations) {
+    run(generations, true);
+}
+
+void CPUCellularAutomaton::run(int generations, bool backward) {
+    if (generations <= 0) {
+        return;
+    }
+
+    if (!m_workers.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobGenerations = generations;
+            m_jobBackward = backward;
+            m_epoch.fetch_add(1, std::memory_order_release);
+        }
+        m_wakeup.notify_all();
+    }
+
+    // Every band ends with a barrier, so the workers are done when this returns
+    runBand(*m_bands[0], generations, backward);
+}
+
+void CPUCellularAutomaton::workerLoop(Band &band) {
+    unsigned seen = 0;
+    while (true) {
+        // Calls usually come back to back: spin a little before sleeping
+        unsigned epoch = m_epoch.load(std::memory_order_acquire);
+        for (int spins = 0; epoch == seen && spins < WORKER_SPINS; spins++) {
+            std::this_thread::yield();
+            epoch = m_epoch.load(std::memory_order_acquire);
+        }
+        if (epoch == seen) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeup.wait(lock, [&] { return m_epoch.load(std::memory_order_acquire) != seen; });
+            epoch = m_epoch.load(std::memory_order_acquire);
+        }
+        seen = epoch;
+
+        if (m_stopping) {
+            return;
+        }
+        runBand(band, m_jobGenerations, m_jobBackward);
+    }
+}
+
+void CPUCellularAutomaton::runBand(Band &band, int generations, bool backward) {
+    // Every thread follows the buffer rotation on its own copy of the indices
+    int prev = m_prev, current = m_current, next = m_next, spare = m_spare;
+    int generation = m_generation;
+
+    if (m_blockKernel) {
+        for (int g = 0; g < generations; g++) {
+            std::copy_n(m_grids[current].data() + band.first * ROW_WORDS, (band.last - band.first) * ROW_WORDS,
+                        m_grids[next].data() + band.first * ROW_WORDS);
+            m_barrier->wait();
+
+            // Undoing a step applies the inverse table on the partition it used, so the
+            // previous grid then keeps the generation that was undone
+            if (backward) {
+                generation--;
+                m_blockKernel(m_grids[next], m_backwardBlocks, generation & 1, band.first, band.last);
+            } else {
+                m_blockKernel(m_grids[next], m_forwardBlocks, generation & 1, band.first, band.last);
+                generation++;
+            }
+            m_barrier->wait();
+
+            std::swap(prev, current);
+            std::swap(current, next);
+        }
+    } else {
+        // Going backward is going forward from the swapped pair (current, prev)
+        for (; m_tiled && generations >= TILE_GENERATIONS; generations -= TILE_GENERATIONS) {
+            if (backward) {
+                runTiles(band, current, prev, spare, next);
+            } else {
+                runTiles(band, prev, current, spare, next);
+            }
+            if (band.index == 0) {
+                m_live[spare] = ~0u;
+                m_live[next] = ~0u;
+            }
+            m_barrier->wait();
+
+            if (backward) {
+                std::swap(current, spare);
+                std::swap(prev, next);
+            } else {
+                std::swap(prev, spare);
+                std::swap(current, next);
+            }
+        }
+
+        for (int g = 0; g < generations; g++) {
+            if (backward) {
+                // S(t-2) = rule(S(t-1)) ^ S(t)
+                stepBand(band, prev, current, next);
+            } else {
+                // S(t+1) = rule(S(t)) ^ S(t-1)
+                stepBand(band, current, prev, next);
+            }
+            m_barrier->wait();
+
+            if (backward) {
+                // Rotate buffers: (prev <- current, current <- next, next <- prev)
+                std::swap(current, next);
+                std::swap(prev, current);
+            } else {
+                // Rotate buffers: (prev -> current, current -> next, next -> prev)
+                std::swap(prev, current);
+                std::swap(current, next);
+            }
+        }
+    }
+
+    // The workers have read the old indices before the first barrier
+    if (band.index == 0) {
+        m_prev = prev;
+        m_current = current;
+        m_next = next;
+        m_spare = spare;
+        m_generation = generation;
+    }
+}
+
+void CPUCellularAutomaton::stepBand(Band &band, int source, int other, int out) {
+    const uint64_t *sourceGrid = m_grids[source].data();
+    const uint64_t *otherGrid = m_grids[other].data();
+    uint64_t *outGrid = m_grids[out].data();
+
+    if (!m_trackActivity) {
+        m_kernel(sourceGrid, otherGrid, outGrid, SIDE, band.first, band.last, m_rule);
+        return;
+    }
+
+    // Bands that may have a live cell: next to a live band of the source grid, or live in the other grid
+    const uint32_t sourceLive = m_live[source].load(std::memory_order_relaxed);
+    uint32_t mayLive = sourceLive | sourceLive << 1 | sourceLive >> 1;
+    if (m_toroidal) {
+        mayLive |= sourceLive << 31 | sourceLive >> 31;
+    }
+    mayLive |= m_live[other].load(std::memory_order_relaxed);
+    const uint32_t wasLive = m_live[out].load(std::memory_order_relaxed);
+
+    const int firstBand = band.first / ACTIVITY_ROWS;
+    const int lastBand = band.last / ACTIVITY_ROWS;
+    uint32_t live = 0;
+
+    for (int b = firstBand; b < lastBand;) {
+        // Runs of bands to compute go to the kernel at once
+        int end = b + 1;
+        const bool compute = mayLive >> b & 1;
+        while (end < lastBand && (mayLive >> end & 1) == compute) {
+            end++;
+        }
+
+        uint64_t *rows = outGrid + b * ACTIVITY_ROWS * ROW_WORDS;
+        if (compute) {
+            m_kernel(sourceGrid, otherGrid, outGrid, SIDE, b * ACTIVITY_ROWS, end * ACTIVITY_ROWS, m_rule);
+            for (int c = b; c < end; c++, rows += ACTIVITY_ROWS * ROW_WORDS) {
+                uint64_t any = 0;
+                for (int w = 0; w < ACTIVITY_ROWS * ROW_WORDS; w++) {
+                    any |= rows[w];
+                }
+                live |= static_cast<uint32_t>(any != 0) << c;
+            }
+        } else {
+            for (int c = b; c < end; c++, rows += ACTIVITY_ROWS * ROW_WORDS) {
+                if (wasLive >> c & 1) {
+                    std::fill_n(rows, ACTIVITY_ROWS * ROW_WORDS, 0);
+                }
+            }
+        }
+        b = end;
+    }
+
+    // Other threads only read these flags after the barrier
+    const uint32_t own = static_cast<uint32_t>((uint64_t{1} << lastBand) - (uint64_t{1} << firstBand));
+    m_live[out].fetch_and(~own | live, std::memory_order_relaxed);
+    m_live[out].fetch_or(live, std::memory_order_relaxed);
+}
+
+uint32_t CPUCellularAutomaton::liveBands(const PackedGrid &grid) {
+    uint32_t live = 0;
+    for (int w = 0; w < GRID_WORDS; w++) {
+        live |= static_cast<uint32_t>(grid[w] != 0) << (w / (ACTIVITY_ROWS * ROW_WORDS));
+    }
+    return live;
+}
+
+void CPUCellularAutomaton::runTiles(Band &band, int prev, int current, int spare, int next) {
+    constexpr int HALO = TILE_GENERATIONS;
+    constexpr int ROWS = TILE_ROWS + 2 * HALO;
+    const int threads = static_cast<int>(m_bands.size());
+    Tile *tiles = band.tiles;
+
+    for (int y0 = band.index * TILE_ROWS; y0 < SIDE; y0 += threads * TILE_ROWS) {
+        // Rows y0 - HALO .. y0 + TILE_ROWS + HALO, dead beyond the grid edges unless it wraps
+        for (int r = 0; r < ROWS; r++) {
+            int y = y0 - HALO + r;
+            uint64_t *tilePrev = tiles[0].data() + r * ROW_WORDS;
+            uint64_t *tileCurrent = tiles[1].data() + r * ROW_WORDS;
+            if (m_toroidal || (y >= 0 && y < SIDE)) {
+                y = (y + SIDE) % SIDE;
+                std::copy_n(m_grids[prev].data() + y * ROW_WORDS, ROW_WORDS, tilePrev);
+                std::copy_n(m_grids[current].data() + y * ROW_WORDS, ROW_WORDS, tileCurrent);
+            } else {
+                std::fill_n(tilePrev, ROW_WORDS, 0);
+                std::fill_n(tileCurrent, ROW_WORDS, 0);
+                std::fill_n(tiles[2].data() + r * ROW_WORDS, ROW_WORDS, 0);
+            }
+        }
+
+        // Rows outside the grid stay dead: they are never computed
+        const int top = m_toroidal ? 0 : std::max(0, HALO - y0);
+        const int bottom = m_toroidal ? ROWS : std::min(ROWS, HALO - y0 + SIDE);
+
+        int tilePrev = 0, tileCurrent = 1, tileNext = 2;
+        for (int g = 1; g <= TILE_GENERATIONS; g++) {
+            m_kernel(tiles[tileCurrent].data(), tiles[tilePrev].data(), tiles[tileNext].data(), ROWS,
+                     std::max(g, top), std::min(ROWS - g, bottom), m_rule);
+            std::swap(tilePrev, tileCurrent);
+            std::swap(tileCurrent, tileNext);
+        }
+
+        const int rows = std::min(TILE_ROWS, SIDE - y0);
+        std::copy_n(tiles[tilePrev].data() + HALO * ROW_WORDS, rows * ROW_WORDS,
+                    m_grids[spare].data() + y0 * ROW_WORDS);
+        std::copy_n(tiles[tileCurrent].data() + HALO * ROW_WORDS, rows * ROW_WORDS,
+                    m_grids[next].data() + y0 * ROW_WORDS);
+    }
+}
+
+void CPUCellularAutomaton::setGeneration(int generation) {
+    m_generation = generation;
+}
+
+void CPUCellularAutomaton::clearPrevGrid() {
+    m_grids[m_prev].fill(0);
+    m_live[m_prev] = 0;
+}
+
+void CPUCellularAutomaton::writeCurrGrid(const std::array<int, BUFFER_SIZE> &currGrid) {
+    packGrid(currGrid, m_grids[m_current]);
+    m_live[m_current] = liveBands(m_grids[m_current]);
+}
+
+void CPUCellularAutomaton::writePrevGrid(const std::array<int, BUFFER_SIZE> &prevGrid) {
+    packGrid(prevGrid, m_grids[m_prev]);
+    m_live[m_prev] = liveBands(m_grids[m_prev]);
+}
+
+void CPUCellularAutomaton::readCurrGrid(std::array<int, BUFFER_SIZE> &currGrid) {
+    unpackGrid(m_grids[m_current], currGrid);
+}
+
+void CPUCellularAutomaton::readPrevGrid(std::array<int, BUFFER_SIZE> &prevGrid) {
+    unpackGrid(m_grids[m_prev], prevGrid);
+}
+
+bool CPUCellularAutomaton::requestSnapshot(int tag) {
+    m_snapshotCurr = m_grids[m_current];
+    m_snapshotPrev = m_grids[m_prev];
+    m_snapshotTag = tag;
+    m_snapshotReady = true;
+    return true;
+}
+
+bool CPUCellularAutomaton::pollSnapshot(PackedGrid &currGrid, PackedGrid &prevGrid, int &tag, bool wait) {
+    if (!m_snapshotReady) {
+        return false;
+    }
+
+    currGrid = m_snapshotCurr;
+    prevGrid = m_snapshotPrev;
+    tag = m_snapshotTag;
+    m_snapshotReady = false;
+    return true;
+}
+
+void CPUCellularAutomaton::beginStats(int generations) {
+    m_stats.clear();
+    m_stats.reserve(generations);
+    m_statsCapacity = generations;
+}
+
+void CPUCellularAutomaton::recordStats() {
+    if (m_stats.size() >= m_statsCapacity) {
+        return;
+    }
+
+    const PackedGrid &current = m_grids[m_current];
+    const PackedGrid &prev = m_grids[m_prev];
+
+    GenerationStats stats;
+    for (int w = 0; w < GRID_WORDS; w++) {
+        stats.live += __builtin_popcountll(current[w]);
+        stats.changed += __builtin_popcountll(current[w] ^ prev[w]);
+    }
+    m_stats.push_back(stats);
+}
+
+std::vector<GenerationStats> CPUCellularAutomaton::readStats() const {
+    return m_stats;
+}
@@ -0,0 +1,140 @@
+#include "CellularAutomaton.h"
+#include <stdexcept>
+
+namespace {
+    // Reads the neighbour counts after a 'B' or 'S', e.g. "23" into bits 2 and 3
+    uint16_t parseCounts(const std::string &notation, size_t &pos) {
+        uint16_t mask = 0;
+        for (; pos < notation.size() && notation[pos] >= '0' && notation[pos] <= '8'; pos++) {
+            mask |= 1 << (notation[pos] - '0');
+        }
+        return mask;
+    }
+
+    int popcount4(int block) {
+        return (block & 1) + (block >> 1 & 1) + (block >> 2 & 1) + (block >> 3 & 1);
+    }
+
+    // Swaps top left with bottom right and top right with bottom left
+    int rotate180(int block) {
+        return (block & 1) << 3 | (block & 2) << 1 | (block & 4) >> 1 | (block & 8) >> 3;
+    }
+
+    // Critters: blocks with two live cells stay, others are complemented, and
+    // complemented blocks that had three live cells are also rotated by 180 degrees
+    int critters(int block) {
+        int count = popcount4(block);
+        if (count == 2) {
+            return block;
+        }
+        return count == 3 ? rotate180(~block & 0xF) : ~block & 0xF;
+    }
+
+    // Tron: uniform blocks are complemented, others stay
+    int tron(int block) {
+        return block == 0 || block == 0xF ? ~block & 0xF : block;
+    }
+
+    struct NamedBlockRule {
+        const char *name;
+        int (*apply)(int block);
+    };
+
+    // Indices are stored in DENIS headers: only ever append
+    const NamedBlockRule BLOCK_RULES[] = {
+        {"critters", critters},
+        {"tron", tron},
+    };
+
+    constexpr int BLOCK_RULE_COUNT = sizeof(BLOCK_RULES) / sizeof(BLOCK_RULES[0]);
+
+    std::string countsToString(uint16_t mask) {
+        std::string counts;
+        for (int n = 0; n <= 8; n++) {
+            if (mask & (1 << n)) {
+                counts += static_cast<char>('0' + n);
+            }
+        }
+        return counts;
+    }
+}
+
+AutomatonRule AutomatonRule::parse(const std::string &notation, Topology topology) {
+    for (int index = 0; index < BLOCK_RULE_COUNT; index++) {
+        if (notation == BLOCK_RULES[index].name) {
+            return margolus(index, topology);
+        }
+    }
+
+    AutomatonRule rule;
+    rule.topology = topology;
+
+    size_t pos = 0;
+    if (pos < notation.size() && (notation[pos] == 'B' || notation[pos] == 'b')) {
+        rule.birth = parseCounts(notation, ++pos);
+        if (pos < notation.size() && notation[pos] == '/') {
+            pos++;
+            if (pos < notation.size() && (notation[pos] == 'S' || notation[pos] == 's')) {
+                rule.survive = parseCounts(notation, ++pos);
+                if (pos == notation.size()) {
+                    return rule;
+                }
+            }
+        }
+    }
+
+    throw std::invalid_argument("[e] Invalid rule: " + notation + ". Expected B/S notation (e.g. B3/S23), critters or tron");
+}
+
+AutomatonRule AutomatonRule::margolus(int blockRule, Topology topology) {
+    if (blockRule < 0 || blockRule >= BLOCK_RULE_COUNT) {
+        throw std::invalid_argument("[e] Unknown Margolus rule: " + std::to_string(blockRule));
+    }
+
+    AutomatonRule rule;
+    rule.neighbourhood = Neighbourhood::Margolus;
+    rule.birth = 0;
+    rule.survive = 0;
+    rule.blockRule = static_cast<uint16_t>(blockRule);
+    rule.topology = topology;
+    return rule;
+}
+
+BlockTable AutomatonRule::blockTable() const {
+    BlockTable table{};
+    for (int block = 0; block < 16; block++) {
+        table[block] = static_cast<uint8_t>(BLOCK_RULES[blockRule].apply(block));
+    }
+    return table;
+}
+
+BlockTable AutomatonRule::inverseBlockTable() const {
+    BlockTable table = blockTable();
+    BlockTable inverse{};
+    for (int block = 0; block < 16; block++) {
+        inverse[table[block]] = static_cast<uint8_t>(block);
+    }
+    return inverse;
+}
+
+Topology AutomatonRule::parseTopology(const std::string &name) {
+    if (name == "dead") {
+        return Topology::DeadBorder;
+    }
+    if (name == "torus") {
+        return Topology::Toroidal;
+    }
+
+    throw std::invalid_argument("[e] Invalid topology: " + name + ". Expected dead or torus");
+}
+
+std::string AutomatonRule::notation() const {
+    if (neighbourhood == Neighbourhood::Margolus) {
+        return BLOCK_RULES[blockRule].name;
+    }
+    return "B" + countsToString(birth) + "/S" + countsToString(survive);
+}
+
+std::string AutomatonRule::topologyName() const {
+    return topology == Topology::Toroidal ? "torus" : "dead";
+}
@@ -25,18 +25,20 @@ CellularAutomatonVisualizer::~CellularAutomatonVisualizer() {
 
 void CellularAutomatonVisualizer::start() {
     if (!m_running.load()) {
+        // A window closed earlier leaves its finished thread to join
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
         m_running.store(true);
         m_thread = std::thread(&CellularAutomatonVisualizer::visualizerThread, this);
     }
 }
 
 void CellularAutomatonVisualizer::stop() {
-    if (m_running.load()) {
-        m_running.store(false);
-        m_cv.notify_all();
-        if (m_thread.joinable()) {
-            m_thread.join();
-        }
+    // The thread clears m_running itself when the window is closed, and must still be joined
+    m_running.store(false);
+    if (m_thread.joinable()) {
+        m_thread.join();
     }
 }
 
@@ -48,22 +50,51 @@ void CellularAutomatonVisualizer::updateGridState(
     int iteration,
     int totalIterations
 ) {
-    GridState state;
+    // Pack straight into the producer's slot, the consumer takes the latest one
+    GridSnapshot &state = m_channel.back();
+    packGrid(currentGrid, state.currentGrid);
+    packGrid(prevGrid, state.prevGrid);
+    state.chunkIndex = chunkIndex;
+    state.totalChunks = totalChunks;
+    state.iteration = iteration;
+    state.totalIterations = totalIterations;
+    m_channel.publish();
+}
+
+void CellularAutomatonVisualizer::updateGridState(
+    const PackedGrid &currentGrid,
+    const PackedGrid &prevGrid,
+    int chunkIndex,
+    int totalChunks,
+    int iteration,
+    int totalIterations
+) {
+    GridSnapshot &state = m_channel.back();
     state.currentGrid = currentGrid;
     state.prevGrid = prevGrid;
     state.chunkIndex = chunkIndex;
     state.totalChunks = totalChunks;
     state.iteration = iteration;
-    state.totalIterations = totalIterations; {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        // Keep queue from growing too large by removing oldest states if needed
-        while (m_stateQueue.size() > 10) {
-            m_stateQueue.pop();
-        }
-        m_stateQueue.push(state);
+    state.totalIterations = totalIterations;
+    m_channel.publish();
+}
+
+void CellularAutomatonVisualizer::replay(TraceReader &trace, int framesPerSecond) {
+    start();
+
+    const auto framePeriod = std::chrono::microseconds(1000000 / std::max(1, framesPerSecond));
+    GridSnapshot snapshot;
+    while (isRunning() && trace.next(snapshot)) {
+        updateGridState(snapshot.currentGrid, snapshot.prevGrid, snapshot.chunkIndex, snapshot.totalChunks,
+                        snapshot.iteration, snapshot.totalIterations);
+        std::this_thread::sleep_for(framePeriod);
     }
 
-    m_cv.notify_one();
+    while (isRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    stop();
 }
 
 bool CellularAutomatonVisualizer::isRunning() const {
@@ -80,20 +111,20 @@ void CellularAutomatonVisualizer::visualizerThread() {
     InitWindow(m_width, m_height, m_title.c_str());
     SetTargetFPS(60);
 
-    GridState currentState{};
+    // The whole grid lives in one greyscale texture, updated when a new state arrives
+    const int gridSide = static_cast<int>(sqrt(BUFFER_SIZE));
+    m_pixels.assign(static_cast<size_t>(gridSide) * gridSide, 255);
+    Image image{m_pixels.data(), gridSide, gridSide, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+    Texture2D gridTexture = LoadTextureFromImage(image);
+    SetTextureFilter(gridTexture, TEXTURE_FILTER_POINT);
+
     bool hasState = false;
 
     while (m_running.load() && !WindowShouldClose()) {
-        // Only check if window should close
-
-        // Always get next state if available
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            if (!m_stateQueue.empty()) {
-                currentState = m_stateQueue.front();
-                m_stateQueue.pop();
-                hasState = true;
-            }
+        // Take the latest published state, if any
+        if (m_channel.acquire()) {
+            hasState = true;
+            uploadGrid(gridTexture, m_channel.front().currentGrid);
         }
 
         // Draw frame
@@ -102,10 +133,10 @@ void CellularAutomatonVisualizer::visualizerThread() {
 
         if (hasState) {
             // Always draw only the current grid, centered
-            drawGrid(currentState.currentGrid, m_width / 4, m_height / 4, m_width / 2, m_height / 2);
+            drawGrid(gridTexture, m_width / 4, m_height / 4, m_width / 2, m_height / 2);
 
             // Draw status information
-            drawStatus(currentState);
+            drawStatus(m_channel.front());
         } else {
             // No data yet
             DrawText("Waiting for data...", 20, m_height / 2 - 20, 30, DARKGRAY);
@@ -122,45 +153,42 @@ void CellularAutomatonVisualizer::visualizerThread() {
         }
     }
 
+    UnloadTexture(gridTexture);
     CloseWindow();
     m_running.store(false);
 }
 
-void CellularAutomatonVisualizer::drawGrid(
-    const std::array<int, BUFFER_SIZE> &grid,
-    int x, int y, int width, int height
+void CellularAutomatonVisualizer::uploadGrid(
+    const Texture &texture,
+    const PackedGrid &grid
 ) {
-    int gridSide = static_cast<int>(sqrt(BUFFER_SIZE));
-    float cellWidth = static_cast<float>(width) / gridSide;
-    float cellHeight = static_cast<float>(height) / gridSide;
-
-    // Only draw cells that would be visible (optimization)
-    int cellsDrawn = 0;
-    const int maxVisibleCells = 10000; // Limit for performance
-
-    for (int gy = 0; gy < gridSide && cellsDrawn < maxVisibleCells; gy++) {
-        for (int gx = 0; gx < gridSide && cellsDrawn < maxVisibleCells; gx++) {
-            int index = gy * gridSide + gx;
-            if (grid[index]) {
-                DrawRectangle(
-                    x + static_cast<int>(gx * cellWidth),
-                    y + static_cast<int>(gy * cellHeight),
-                    std::max(1, static_cast<int>(cellWidth)),
-                    std::max(1, static_cast<int>(cellHeight)),
-                    BLACK
-                );
-                cellsDrawn++;
-            }
+    for (int w = 0; w < GRID_WORDS; w++) {
+        uint8_t *pixels = m_pixels.data() + w * 64;
+        for (int b = 0; b < 64; b++) {
+            pixels[b] = (grid[w] >> b) & 1 ? 0 : 255;
         }
     }
 
+    UpdateTexture(texture, m_pixels.data());
+}
+
+void CellularAutomatonVisualizer::drawGrid(
+    const Texture &texture,
+    int x, int y, int width, int height
+) {
+    // Scale the texture over the grid area; point filtering keeps cells sharp
+    Rectangle source{0.0f, 0.0f, static_cast<float>(texture.width), static_cast<float>(texture.height)};
+    Rectangle dest{
+        static_cast<float>(x), static_cast<float>(y),
+        static_cast<float>(width), static_cast<float>(height)
+    };
+    DrawTexturePro(texture, source, dest, Vector2{0.0f, 0.0f}, 0.0f, WHITE);
+
     // Draw grid outline
     DrawRectangleLines(x, y, width, height, BLACK);
-
-    // No need for grid label
 }
 
-void CellularAutomatonVisualizer::drawStatus(const GridState &state) {
+void CellularAutomatonVisualizer::drawStatus(const GridSnapshot &state) {
     std::stringstream statusText;
     statusText << "Chunk: " << (state.chunkIndex + 1) << " / " << state.totalChunks;
 
@@ -0,0 +1,195 @@
+#include "ChunkScheduler.h"
+#include "CPUCellularAutomaton.h"
+#include "GPUCellularAutomaton.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+ChunkScheduler::ChunkScheduler(const AutomatonRule &rule, unsigned int cpuWorkers, unsigned int gpuStreams)
+    : m_rule(rule), m_gpuStreams(gpuStreams) {
+    if (cpuWorkers == 0) {
+        cpuWorkers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (unsigned int w = 0; w < cpuWorkers; w++) {
+        m_cpu.push_back(std::make_unique<CPUCellularAutomaton>(rule, CPUKernel::BitSliced));
+    }
+    m_gpu.resize(m_gpuStreams);
+    m_backends.resize(m_gpuStreams + m_cpu.size());
+}
+
+void ChunkScheduler::run(size_t count, long long generations, const ChunkJob &job) {
+    run(std::vector<long long>(count, generations), job);
+}
+
+void ChunkScheduler::run(const std::vector<long long> &generations, const ChunkJob &job) {
+    const size_t count = generations.size();
+    m_front = 0;
+    m_back = count;
+    m_error = nullptr;
+    m_gpuChunks = 0;
+    m_cpuChunks = 0;
+
+    // Every chunk counts for at least one generation, so rates stay finite
+    m_prefix.assign(count + 1, 0);
+    for (size_t c = 0; c < count; c++) {
+        m_prefix[c + 1] = m_prefix[c] + std::max(1LL, generations[c]);
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // GPU engines (and EGL) are only set up once a job is worth it
+    bool useGPU = m_gpuStreams > 0 && !m_gpuUnavailable && m_prefix[count] >= SMALL_JOB_GENERATIONS;
+    if (useGPU && !m_gpu[0]) {
+        try {
+            m_gpu[0] = std::make_unique<GPUCellularAutomaton>(m_rule);
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << ": running on the CPU only" << std::endl;
+            m_gpuUnavailable = true;
+            useGPU = false;
+        }
+    }
+    const size_t streams = useGPU ? std::min(m_gpuStreams, count) : 0;
+    if (streams > 1 && !m_pool) {
+        m_pool = std::make_unique<EGLContextPool>(static_cast<int>(m_gpuStreams - 1));
+    }
+
+    const size_t workers = std::min(m_cpu.size(), count);
+    for (size_t s = 0; s < m_gpuStreams; s++) {
+        m_backends[s].active = s < streams;
+    }
+    for (size_t w = 0; w < m_cpu.size(); w++) {
+        m_backends[m_gpuStreams + w].active = w < workers;
+    }
+
+    // Without the GPU, the calling thread runs the first CPU worker
+    std::vector<std::thread> threads;
+    for (size_t s = 1; s < streams; s++) {
+        threads.emplace_back(&ChunkScheduler::runGPU, this, s, std::cref(job));
+    }
+    for (size_t w = useGPU ? 0 : 1; w < workers; w++) {
+        threads.emplace_back(&ChunkScheduler::runCPU, this, w, std::cref(job));
+    }
+    if (useGPU) {
+        runGPU(0, job);
+    } else {
+        runCPU(0, job);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    if (m_error) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+size_t ChunkScheduler::claim(size_t backend, size_t &first) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Backend &self = m_backends[backend];
+    if (m_front >= m_back) {
+        self.active = false;
+        return 0;
+    }
+    const double left = static_cast<double>(generationsOf(m_front, m_back));
+
+    // Rates of the backends still running, known once all of them are measured
+    double others = 0;
+    bool known = self.rate > 0;
+    for (size_t b = 0; b < m_backends.size(); b++) {
+        if (b != backend && m_backends[b].active) {
+            known = known && m_backends[b].rate > 0;
+            others += m_backends[b].rate;
+        }
+    }
+
+    // Stop when the others run every chunk left before this backend would run its next one
+    const size_t next = backend < m_gpuStreams ? m_front : m_back - 1;
+    if (known && others > 0 && left / others < static_cast<double>(generationsOf(next, next + 1)) / self.rate) {
+        self.active = false;
+        return 0;
+    }
+
+    if (backend >= m_gpuStreams) {
+        first = --m_back;
+        return 1;
+    }
+
+    // The stream's share of the generations left, capped so its rate is measured again soon
+    size_t last = m_front + 1;
+    if (self.rate > 0) {
+        const double share = left * self.rate / (self.rate + others);
+        const double target = std::min(share, self.rate * BATCH_SECONDS);
+        while (last < m_back && static_cast<double>(generationsOf(m_front, last + 1)) <= target) {
+            last++;
+        }
+    }
+    first = m_front;
+    m_front = last;
+    return last - first;
+}
+
+void ChunkScheduler::measured(size_t backend, size_t first, size_t chunks, double seconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const double sample = static_cast<double>(generationsOf(first, first + chunks)) / std::max(seconds, 1e-9);
+    double &rate = m_backends[backend].rate;
+    rate = rate > 0 ? RATE_SMOOTHING * sample + (1 - RATE_SMOOTHING) * rate : sample;
+
+    if (backend < m_gpuStreams) {
+        m_gpuChunks += chunks;
+    } else {
+        m_cpuChunks += chunks;
+    }
+}
+
+void ChunkScheduler::fail(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_error) {
+        m_error = error;
+    }
+    m_front = m_back;
+}
+
+void ChunkScheduler::runGPU(size_t stream, const ChunkJob &job) {
+    try {
+        if (stream > 0) {
+            m_pool->makeCurrent(static_cast<int>(stream - 1));
+            if (!m_gpu[stream]) {
+                m_gpu[stream] = std::make_unique<GPUCellularAutomaton>(m_rule);
+            }
+        }
+
+        size_t first = 0;
+        while (size_t batch = claim(stream, first)) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t chunk = first; chunk < first + batch; chunk++) {
+                job(*m_gpu[stream], chunk);
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            measured(stream, first, batch, elapsed.count());
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    // The context may be made current on another thread next time
+    if (stream > 0) {
+        EGLContextPool::release();
+    }
+}
+
+void ChunkScheduler::runCPU(size_t worker, const ChunkJob &job) {
+    try {
+        size_t chunk = 0;
+        while (claim(m_gpuStreams + worker, chunk)) {
+            auto start = std::chrono::steady_clock::now();
+            job(*m_cpu[worker], chunk);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            measured(m_gpuStreams + worker, chunk, 1, elapsed.count());
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
@@ -0,0 +1,394 @@
+#include "DenisService.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // How long the listener is left alone after accept() failed, out of descriptors say
+    constexpr std::chrono::milliseconds ACCEPT_BACKOFF{100};
+
+    sockaddr_un socketAddress(const std::string &path) {
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("[e] Invalid socket path: " + path);
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    // Copies `text` into a fixed-size field, truncating it and always NUL-terminating
+    template<size_t N>
+    void copyField(char (&field)[N], const std::string &text) {
+        const size_t length = std::min(text.size(), N - 1);
+        std::memcpy(field, text.data(), length);
+        field[length] = '\0';
+    }
+
+    // Sends a reply, ignoring clients that hung up in the meantime
+    void sendReply(int socket, ServiceReply reply) {
+        reply.magic = SERVICE_MAGIC;
+        while (send(socket, &reply, sizeof(reply), MSG_NOSIGNAL) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+ServiceJob::~ServiceJob() {
+    if (input >= 0) {
+        close(input);
+    }
+    if (output >= 0) {
+        close(output);
+    }
+}
+
+std::vector<uint8_t> ServiceJob::readInput() const {
+    std::vector<uint8_t> data;
+    uint8_t buffer[1 << 16];
+    for (;;) {
+        const ssize_t count = read(input, buffer, sizeof(buffer));
+        if (count == 0) {
+            return data;
+        }
+        if (count < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("[e] Error reading input: ") + std::strerror(errno));
+        }
+        if (count > 0) {
+            data.insert(data.end(), buffer, buffer + count);
+        }
+    }
+}
+
+void ServiceJob::writeOutput(const std::vector<uint8_t> &data) const {
+    for (size_t written = 0; written < data.size();) {
+        const ssize_t count = write(output, data.data() + written, data.size() - written);
+        if (count < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("[e] Error writing output: ") + std::strerror(errno));
+        }
+        if (count > 0) {
+            written += count;
+        }
+    }
+}
+
+void ServiceJob::fail(const std::string &message) {
+    reply.status = 1;
+    copyField(reply.message, message);
+}
+
+struct DenisServer::Client {
+    int socket = -1;
+    bool hungUp = false;
+    std::deque<std::unique_ptr<ServiceJob>> jobs;
+
+    ~Client() {
+        close(socket);
+    }
+};
+
+DenisServer::DenisServer(const std::string &path) : m_path(path) {
+    const sockaddr_un address = socketAddress(path);
+    m_socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (m_socket < 0) {
+        throw std::runtime_error(std::string("[e] Error creating socket: ") + std::strerror(errno));
+    }
+
+    // A socket file no server accepts on was left by one that did not exit cleanly
+    struct stat info{};
+    if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        if (connect(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0) {
+            close(m_socket);
+            throw std::runtime_error("[e] A server is already listening on " + path);
+        }
+        unlink(path.c_str());
+    }
+
+    if (bind(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(m_socket, SOMAXCONN) != 0) {
+        const int error = errno;
+        close(m_socket);
+        throw std::runtime_error("[e] Error listening on " + path + ": " + std::strerror(error));
+    }
+
+    if (pipe2(m_wakeup, O_CLOEXEC | O_NONBLOCK) != 0) {
+        const int error = errno;
+        close(m_socket);
+        unlink(path.c_str());
+        throw std::runtime_error(std::string("[e] Error creating pipe: ") + std::strerror(error));
+    }
+}
+
+DenisServer::~DenisServer() {
+    close(m_socket);
+    unlink(m_path.c_str());
+    close(m_wakeup[0]);
+    close(m_wakeup[1]);
+}
+
+void DenisServer::stop() {
+    m_stopping.store(true);
+    wake();
+}
+
+void DenisServer::wake() {
+    const char byte = 0;
+    while (write(m_wakeup[1], &byte, 1) < 0 && errno == EINTR) {
+    }
+}
+
+void DenisServer::serve(const RoundRunner &run) {
+    std::thread receiver(&DenisServer::receive, this);
+
+    for (;;) {
+        std::vector<std::pair<std::shared_ptr<Client>, std::unique_ptr<ServiceJob>>> round;
+        bool unblocked = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queued.wait(lock, [this] {
+                return m_stopping.load() || std::any_of(m_clients.begin(), m_clients.end(), [](const auto &client) {
+                    return !client->jobs.empty();
+                });
+            });
+            if (m_stopping.load()) {
+                break;
+            }
+
+            // Forget clients that hung up, keeping the turn on the same client
+            for (size_t c = m_clients.size(); c-- > 0;) {
+                if (m_clients[c]->hungUp) {
+                    m_clients.erase(m_clients.begin() + c);
+                    m_turn -= c < m_turn ? 1 : 0;
+                }
+            }
+
+            // The oldest request of each client, the next round starting after the last one taken
+            const size_t clients = m_clients.size();
+            const size_t start = m_turn;
+            for (size_t n = 0; n < clients && round.size() < ROUND_JOBS; n++) {
+                const std::shared_ptr<Client> &client = m_clients[(start + n) % clients];
+                if (!client->jobs.empty()) {
+                    unblocked = unblocked || client->jobs.size() >= CLIENT_JOBS;
+                    round.emplace_back(client, std::move(client->jobs.front()));
+                    client->jobs.pop_front();
+                    m_turn = (start + n + 1) % clients;
+                }
+            }
+        }
+
+        // A client whose queue was full can be read again
+        if (unblocked) {
+            wake();
+        }
+
+        std::vector<ServiceJob *> jobs;
+        for (auto &[client, job] : round) {
+            jobs.push_back(job.get());
+        }
+        try {
+            run(jobs);
+        } catch (const std::exception &e) {
+            for (ServiceJob *job : jobs) {
+                job->fail(e.what());
+            }
+        }
+
+        for (auto &[client, job] : round) {
+            sendReply(client->socket, job->reply);
+        }
+    }
+
+    receiver.join();
+}
+
+void DenisServer::receive() {
+    // Clients this thread polls; m_clients also holds them for serve()
+    std::vector<std::shared_ptr<Client>> connected;
+
+    std::chrono::steady_clock::time_point acceptAfter{};
+    bool acceptFailing = false;         // Reported once until a client is accepted again
+
+    while (!m_stopping.load()) {
+        // Negative descriptors are skipped: the listener while backing off, and clients
+        // with a full queue until serve() takes one of their requests and wakes this thread
+        const auto now = std::chrono::steady_clock::now();
+        const bool accepting = now >= acceptAfter;
+        std::vector<pollfd> fds = {{m_wakeup[0], POLLIN, 0}, {accepting ? m_socket : -1, POLLIN, 0}};
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto &client : connected) {
+                fds.push_back({client->jobs.size() < CLIENT_JOBS ? client->socket : -1, POLLIN, 0});
+            }
+        }
+
+        const auto backoff = std::chrono::ceil<std::chrono::milliseconds>(acceptAfter - now);
+        if (poll(fds.data(), fds.size(), accepting ? -1 : static_cast<int>(backoff.count())) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents) {
+            char bytes[64];
+            while (read(m_wakeup[0], bytes, sizeof(bytes)) > 0) {
+            }
+        }
+
+        for (size_t c = connected.size(); c-- > 0;) {
+            if (fds[c + 2].revents && !receiveRequest(connected[c])) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                connected[c]->hungUp = true;
+                connected[c]->jobs.clear();
+                connected.erase(connected.begin() + c);
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            const int socket = accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+            if (socket >= 0) {
+                auto client = std::make_shared<Client>();
+                client->socket = socket;
+                connected.push_back(client);
+                acceptFailing = false;
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_clients.push_back(client);
+            } else if (errno != EINTR && errno != EAGAIN && errno != ECONNABORTED) {
+                // The connection stays pending until finished jobs free descriptors
+                if (!acceptFailing) {
+                    std::cerr << "[e] Error accepting a client: " << std::strerror(errno) << std::endl;
+                    acceptFailing = true;
+                }
+                acceptAfter = std::chrono::steady_clock::now() + ACCEPT_BACKOFF;
+            }
+        }
+    }
+
+    // Wakes serve() when stopped, under the lock so the wakeup cannot be missed
+    m_stopping.store(true);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queued.notify_all();
+}
+
+bool DenisServer::receiveRequest(const std::shared_ptr<Client> &client) {
+    auto job = std::make_unique<ServiceJob>();
+    iovec io{&job->request, sizeof(ServiceRequest)};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))];
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    const ssize_t received = recvmsg(client->socket, &message, MSG_CMSG_CLOEXEC);
+    if (received < 0) {
+        return errno == EINTR || errno == EAGAIN;
+    }
+    if (received == 0) {
+        return false;
+    }
+
+    // The job owns the descriptors from here on, so they are closed however the request turns out
+    size_t attached = 0;
+    for (cmsghdr *header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int fd;
+            std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+            if (attached == 0) {
+                job->input = fd;
+            } else if (attached == 1) {
+                job->output = fd;
+            } else {
+                close(fd);
+            }
+            attached++;
+        }
+    }
+
+    if (message.msg_flags & MSG_CTRUNC) {
+        job->fail("[e] The server is out of descriptors, retry later");
+    } else if (received != sizeof(ServiceRequest) || (message.msg_flags & MSG_TRUNC) ||
+               job->request.magic != SERVICE_MAGIC) {
+        job->fail("[e] Malformed request");
+    } else if (attached != 2) {
+        job->fail("[e] A request needs its input and output files attached");
+    }
+
+    // Failed requests are queued too, so their replies keep their place in order
+    job->request.rule[sizeof(job->request.rule) - 1] = '\0';
+    job->request.topology[sizeof(job->request.topology) - 1] = '\0';
+    job->request.key[sizeof(job->request.key) - 1] = '\0';
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    client->jobs.push_back(std::move(job));
+    m_queued.notify_one();
+    return true;
+}
+
+DenisClient::DenisClient(const std::string &path) {
+    const sockaddr_un address = socketAddress(path);
+    m_socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (m_socket < 0) {
+        throw std::runtime_error(std::string("[e] Error creating socket: ") + std::strerror(errno));
+    }
+    if (connect(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        const int error = errno;
+        close(m_socket);
+        throw std::runtime_error("[e] Error connecting to " + path + ": " + std::strerror(error));
+    }
+}
+
+DenisClient::~DenisClient() {
+    close(m_socket);
+}
+
+ServiceReply DenisClient::submit(ServiceRequest request, int input, int output) {
+    request.magic = SERVICE_MAGIC;
+    iovec io{&request, sizeof(request)};
+    alignas(cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    msghdr message{};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr *header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    const int fds[2] = {input, output};
+    std::memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    ssize_t sent;
+    while ((sent = sendmsg(m_socket, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR) {
+    }
+    if (sent != static_cast<ssize_t>(sizeof(request))) {
+        throw std::runtime_error(std::string("[e] Error sending request: ") + std::strerror(errno));
+    }
+
+    ServiceReply reply;
+    ssize_t received;
+    while ((received = recv(m_socket, &reply, sizeof(reply), 0)) < 0 && errno == EINTR) {
+    }
+    if (received != static_cast<ssize_t>(sizeof(reply)) || reply.magic != SERVICE_MAGIC) {
+        throw std::runtime_error("[e] The server closed the connection without replying");
+    }
+
+    reply.key[sizeof(reply.key) - 1] = '\0';
+    reply.message[sizeof(reply.message) - 1] = '\0';
+    return reply;
+}
@@ -1,28 +1,130 @@
 #include <EGLManager.h>
 #include <GL/glew.h>
 #include <EGL/egl.h>
-#include <iostream>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 
-EGLDisplay eglDpy;
-EGLContext eglCtx;
+EGLDisplay eglDpy = EGL_NO_DISPLAY;
+EGLContext eglCtx = EGL_NO_CONTEXT;
+EGLConfig eglConfig;
+EGLSurface eglSurface = EGL_NO_SURFACE;
+bool eglSurfaceless = false;
+std::mutex eglMutex;
+
+namespace {
+    bool hasExtension(const char *extensions, const char *name) {
+        const size_t length = std::strlen(name);
+        for (const char *found = extensions ? std::strstr(extensions, name) : nullptr; found;
+             found = std::strstr(found + length, name)) {
+            if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // An initialised display on an enumerated device, hardware ones first, or
+    // EGL_NO_DISPLAY when the device extensions are missing or no device works
+    EGLDisplay deviceDisplay() {
+        const char *client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (!hasExtension(client, "EGL_EXT_device_enumeration") || !hasExtension(client, "EGL_EXT_platform_device")) {
+            return EGL_NO_DISPLAY;
+        }
+
+        auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+        auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(
+            eglGetProcAddress("eglQueryDeviceStringEXT"));
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        EGLint count = 0;
+        if (!queryDevices || !queryDeviceString || !getPlatformDisplay || !queryDevices(0, nullptr, &count)) {
+            return EGL_NO_DISPLAY;
+        }
+
+        std::vector<EGLDeviceEXT> devices(count);
+        if (count == 0 || !queryDevices(count, devices.data(), &count)) {
+            return EGL_NO_DISPLAY;
+        }
+
+        for (bool software : {false, true}) {
+            for (EGLDeviceEXT device : devices) {
+                const char *extensions = queryDeviceString(device, EGL_EXTENSIONS);
+                if (hasExtension(extensions, "EGL_MESA_device_software") != software) {
+                    continue;
+                }
+
+                EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+                EGLint major, minor;
+                if (display != EGL_NO_DISPLAY && eglInitialize(display, &major, &minor)) {
+                    return display;
+                }
+            }
+        }
+        return EGL_NO_DISPLAY;
+    }
+
+    // A 1x1 pbuffer to make a context current on, for displays that need a surface
+    EGLSurface createPbuffer() {
+        EGLint pbufferAttribs[] = {
+            EGL_WIDTH, 1,
+            EGL_HEIGHT, 1,
+            EGL_NONE,
+        };
+        return eglCreatePbufferSurface(eglDpy, eglConfig, pbufferAttribs);
+    }
+
+    EGLContext createContext(EGLContext shared) {
+        EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 3,  // Minimum for compute shaders
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        return eglCreateContext(eglDpy, eglConfig, shared, contextAttribs);
+    }
+}
 
 void EGLManager::init() {
-    // 1. Initialize EGL
-    eglDpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
-    if (eglDpy == EGL_NO_DISPLAY) {
-        std::cerr << "EGL: Failed to get display" << std::endl;
-        exit(1);
+    std::lock_guard<std::mutex> lock(eglMutex);
+    if (eglCtx != EGL_NO_CONTEXT) {
+        return;
     }
 
-    EGLint major, minor;
-    if (!eglInitialize(eglDpy, &major, &minor)) {
-        std::cerr << "EGL: Failed to initialize" << std::endl;
-        exit(1);
+    // Undoes what was set up so far, so a later call starts over
+    auto fail = [](const std::string &message) {
+        if (eglSurface != EGL_NO_SURFACE) {
+            eglDestroySurface(eglDpy, eglSurface);
+            eglSurface = EGL_NO_SURFACE;
+        }
+        if (eglDpy != EGL_NO_DISPLAY) {
+            eglTerminate(eglDpy);
+            eglDpy = EGL_NO_DISPLAY;
+        }
+        throw std::runtime_error("[e] EGL: " + message);
+    };
+
+    // 1. Initialize EGL on a device, or on the default display
+    eglDpy = deviceDisplay();
+    if (eglDpy == EGL_NO_DISPLAY) {
+        eglDpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (eglDpy == EGL_NO_DISPLAY) {
+            fail("Failed to get display");
+        }
+
+        EGLint major, minor;
+        if (!eglInitialize(eglDpy, &major, &minor)) {
+            fail("Failed to initialize");
+        }
     }
 
-    // 2. Select an appropriate configuration
+    // 2. Select an appropriate configuration; compute shaders need no surface
+    // where contexts can be made current without one
+    eglSurfaceless = hasExtension(eglQueryString(eglDpy, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
     EGLint configAttribs[] = {
-        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_SURFACE_TYPE, eglSurfaceless ? 0 : EGL_PBUFFER_BIT,
         EGL_BLUE_SIZE, 8,
         EGL_GREEN_SIZE, 8,
         EGL_RED_SIZE, 8,
@@ -31,56 +133,100 @@ void EGLManager::init() {
         EGL_NONE
     };
 
-    EGLConfig config;
     EGLint numConfigs;
-    if (!eglChooseConfig(eglDpy, configAttribs, &config, 1, &numConfigs)) {
-        std::cerr << "EGL: Failed to choose config" << std::endl;
-        exit(1);
+    if (!eglChooseConfig(eglDpy, configAttribs, &eglConfig, 1, &numConfigs) || numConfigs == 0) {
+        fail("Failed to choose config");
     }
 
-    // 3. Create a dummy pbuffer surface
-    EGLint pbufferAttribs[] = {
-        EGL_WIDTH, 1,
-        EGL_HEIGHT, 1,
-        EGL_NONE,
-    };
-
-    EGLSurface surface = eglCreatePbufferSurface(eglDpy, config, pbufferAttribs);
-    if (surface == EGL_NO_SURFACE) {
-        std::cerr << "EGL: Failed to create pbuffer surface" << std::endl;
-        exit(1);
+    // 3. Create a dummy pbuffer surface if needed
+    if (!eglSurfaceless) {
+        eglSurface = createPbuffer();
+        if (eglSurface == EGL_NO_SURFACE) {
+            fail("Failed to create pbuffer surface");
+        }
     }
 
     // 4. Bind the API
     eglBindAPI(EGL_OPENGL_API);
 
     // 5. Create a context and make it current
-    EGLint contextAttribs[] = {
-        EGL_CONTEXT_MAJOR_VERSION, 4,
-        EGL_CONTEXT_MINOR_VERSION, 3,  // Minimum for compute shaders
-        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
-        EGL_NONE
-    };
-
-    eglCtx = eglCreateContext(eglDpy, config, EGL_NO_CONTEXT, contextAttribs);
-    if (eglCtx == EGL_NO_CONTEXT) {
-        std::cerr << "EGL: Failed to create context" << std::endl;
-        exit(1);
+    EGLContext context = createContext(EGL_NO_CONTEXT);
+    if (context == EGL_NO_CONTEXT) {
+        fail("Failed to create context");
     }
 
-    if (!eglMakeCurrent(eglDpy, surface, surface, eglCtx)) {
-        std::cerr << "EGL: Failed to make context current" << std::endl;
-        exit(1);
+    if (!eglMakeCurrent(eglDpy, eglSurface, eglSurface, context)) {
+        eglDestroyContext(eglDpy, context);
+        fail("Failed to make context current");
     }
 
     if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to initialize GLEW" << std::endl;
-        exit(1);
+        eglMakeCurrent(eglDpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(eglDpy, context);
+        fail("Failed to initialize GLEW");
     }
+    eglCtx = context;
 }
 
 void EGLManager::cleanup() {
+    std::lock_guard<std::mutex> lock(eglMutex);
+    if (eglCtx == EGL_NO_CONTEXT) {
+        return;
+    }
+
     eglMakeCurrent(eglDpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglDestroyContext(eglDpy, eglCtx);
+    eglCtx = EGL_NO_CONTEXT;
+    if (eglSurface != EGL_NO_SURFACE) {
+        eglDestroySurface(eglDpy, eglSurface);
+        eglSurface = EGL_NO_SURFACE;
+    }
     eglTerminate(eglDpy);
-}
\ No newline at end of file
+    eglDpy = EGL_NO_DISPLAY;
+}
+
+EGLContextPool::EGLContextPool(int contexts) {
+    EGLManager::init();
+    eglBindAPI(EGL_OPENGL_API);
+    for (int i = 0; i < contexts; i++) {
+        EGLContext context = createContext(eglCtx);
+        if (context == EGL_NO_CONTEXT) {
+            destroy();
+            throw std::runtime_error("[e] EGL: Failed to create worker context");
+        }
+        m_contexts.push_back(context);
+
+        EGLSurface surface = eglSurfaceless ? EGL_NO_SURFACE : createPbuffer();
+        if (!eglSurfaceless && surface == EGL_NO_SURFACE) {
+            destroy();
+            throw std::runtime_error("[e] EGL: Failed to create worker pbuffer surface");
+        }
+        m_surfaces.push_back(surface);
+    }
+}
+
+EGLContextPool::~EGLContextPool() {
+    destroy();
+}
+
+void EGLContextPool::destroy() {
+    for (size_t i = 0; i < m_contexts.size(); i++) {
+        eglDestroyContext(eglDpy, m_contexts[i]);
+        if (i < m_surfaces.size() && m_surfaces[i] != EGL_NO_SURFACE) {
+            eglDestroySurface(eglDpy, m_surfaces[i]);
+        }
+    }
+    m_contexts.clear();
+    m_surfaces.clear();
+}
+
+void EGLContextPool::makeCurrent(int index) {
+    eglBindAPI(EGL_OPENGL_API);
+    if (!eglMakeCurrent(eglDpy, m_surfaces[index], m_surfaces[index], m_contexts[index])) {
+        throw std::runtime_error("[e] EGL: Failed to make worker context current");
+    }
+}
+
+void EGLContextPool::release() {
+    eglMakeCurrent(eglDpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
@@ -79,12 +79,40 @@ DenisHeader DenisDecoder::ReadVersion2Header(std::vector<byte> &buffer) {
     return {magic, version, type, dataSize, padding, extra};
 }
 
+DenisHeader DenisDecoder::ReadVersion3Header(std::vector<byte> &buffer) {
+    // version 2 layout, with the automaton stored in the extra field
+    DenisHeader header = ReadVersion2Header(buffer);
+
+    header.automaton.birth = FileManagementHelper::BytesToInt({buffer.begin() + 11, buffer.begin() + 13}, 2);
+    header.automaton.survive = FileManagementHelper::BytesToInt({buffer.begin() + 13, buffer.begin() + 15}, 2);
+    header.automaton.flags = FileManagementHelper::BytesToInt({buffer.begin() + 15, buffer.begin() + 16}, 1);
+    if (header.automaton.birth >= 1 << 9 || header.automaton.survive >= 1 << 9) {
+        throw std::runtime_error("[e] Invalid automaton rule in header.");
+    }
+
+    return header;
+}
+
 DenisHeader DenisDecoder::ReadHeader(std::vector<byte> &buffer) {
     switch (GetVersion()) {
         case 1:
             return ReadVersion1Header(buffer);
         case 2:
             return ReadVersion2Header(buffer);
+        case 3: {
+            // a version 3 decoder also reads the older files
+            int fileVersion = FileManagementHelper::BytesToInt({buffer.begin() + 5, buffer.begin() + 6}, 1);
+            switch (fileVersion) {
+                case 1:
+                    return ReadVersion1Header(buffer);
+                case 2:
+                    return ReadVersion2Header(buffer);
+                case 3:
+                    return ReadVersion3Header(buffer);
+                default:
+                    throw std::runtime_error("[e] Unsupported file version: " + std::to_string(fileVersion));
+            }
+        }
         default:
             throw std::invalid_argument("[e] Unsupported version: " + std::to_string(GetVersion()));
     }
@@ -95,25 +123,32 @@ std::pair<DenisHeader, std::vector<byte>> DenisDecoder::Decode(std::string &fp)
     uintmax_t fileSize = file_size(std::filesystem::path(fp));
 
     // Read the file into buffer
-    std::vector<byte> buffer = FileManagementHelper::ReadBuffer(fp, fileSize);
+    return Decode(FileManagementHelper::ReadBuffer(fp, fileSize));
+}
+
+std::pair<DenisHeader, std::vector<byte>> DenisDecoder::Decode(const std::vector<byte> &buffer) {
     if (buffer.empty()) {
         throw std::runtime_error("[e] Buffer is empty.");
     }
 
+    if (buffer.size() < HEADER_LENGTH + DENIS_TERMINATOR.size()) {
+        throw std::runtime_error("[e] Buffer is too short: " + std::to_string(buffer.size()) + " bytes.");
+    }
+
     // Read header
     std::vector headerBuffer(buffer.begin(), buffer.begin() + HEADER_LENGTH);
     DenisHeader header = ReadHeader(headerBuffer);
 
-    // Extract content and terminator
-    std::vector content(buffer.begin() + HEADER_LENGTH, buffer.begin() + HEADER_LENGTH + header.data_size);
-    std::vector terminator(buffer.begin() + HEADER_LENGTH + header.data_size, buffer.end());
-
     // Validate content size
-    if (header.data_size != static_cast<int>(content.size())) {
+    if (header.data_size < 0 || buffer.size() - HEADER_LENGTH < static_cast<size_t>(header.data_size)) {
         throw std::runtime_error("[e] Data size mismatch: " + std::to_string(header.data_size) +
-                                 " instead of " + std::to_string(content.size()));
+                                 " instead of " + std::to_string(buffer.size() - HEADER_LENGTH));
     }
 
+    // Extract content and terminator
+    std::vector content(buffer.begin() + HEADER_LENGTH, buffer.begin() + HEADER_LENGTH + header.data_size);
+    std::vector terminator(buffer.begin() + HEADER_LENGTH + header.data_size, buffer.end());
+
     // Validate terminator
     if (terminator != DENIS_TERMINATOR) {
         throw std::runtime_error("[e] Invalid terminator: " + FileManagementHelper::BytesToString(terminator) +
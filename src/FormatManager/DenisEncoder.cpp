@@ -18,16 +18,7 @@ int DenisEncoder::GetVersion() {
 
 void DenisEncoder::Encode(std::string &fp, std::vector<byte> &data, DenisExtensionType type, int padding) {
     // encode the data and write it to the file
-    if (type == DenisExtensionType::NONE) {
-        throw std::invalid_argument("[e] Format cannot be NONE.");
-    }
-
-    std::vector<byte> bufferToWrite;
-    std::vector<byte> header = GetHeader(data, type, padding);
-
-    bufferToWrite.insert(bufferToWrite.end(), header.begin(), header.end());        // header
-    bufferToWrite.insert(bufferToWrite.end(), data.begin(), data.end());            // data to write
-    bufferToWrite.insert(bufferToWrite.end(), DENIS_TERMINATOR.begin(), DENIS_TERMINATOR.end()); // terminator
+    std::vector<byte> bufferToWrite = EncodeToBuffer(data, type, padding);
 
     // Open file in write mode (not append) to overwrite any existing content
     std::ofstream file(fp, std::ios::binary);
@@ -44,6 +35,28 @@ void DenisEncoder::Encode(std::string &fp, std::vector<byte> &data, DenisExtensi
     }
 }
 
+std::vector<byte> DenisEncoder::EncodeToBuffer(std::vector<byte> &data, DenisExtensionType type, int padding) {
+    // encode the data into an in-memory DENIS file
+    if (type == DenisExtensionType::NONE) {
+        throw std::invalid_argument("[e] Format cannot be NONE.");
+    }
+
+    std::vector<byte> buffer;
+    std::vector<byte> header = GetHeader(data, type, padding);
+    buffer.reserve(header.size() + data.size() + DENIS_TERMINATOR.size());
+
+    buffer.insert(buffer.end(), header.begin(), header.end());        // header
+    buffer.insert(buffer.end(), data.begin(), data.end());            // data to write
+    buffer.insert(buffer.end(), DENIS_TERMINATOR.begin(), DENIS_TERMINATOR.end()); // terminator
+
+    return buffer;
+}
+
+void DenisEncoder::SetAutomaton(const DenisAutomaton &automaton) {
+    // only recorded by version 3 headers
+    automaton_ = automaton;
+}
+
 std::vector<byte> DenisEncoder::GetVersion1Header(std::vector<byte> &data, DenisExtensionType type) {
     
     std::vector<byte> buffer;
@@ -92,6 +105,37 @@ std::vector<byte> DenisEncoder::GetVersion2Header(std::vector<byte> &data, Denis
 
 }
 
+std::vector<byte> DenisEncoder::GetVersion3Header(std::vector<byte> &data, DenisExtensionType type, int padding,
+                                                 const DenisAutomaton &automaton) {
+
+    std::vector<byte> buffer;
+    std::vector<byte> magicString = FileManagementHelper::StringToBytes(DENIS_MAGIC_STRING);
+    std::vector<byte> versionBytes = FileManagementHelper::IntToBytes(3, 1);
+    std::vector<byte> formatBytes = FileManagementHelper::StringToBytes(EXTENSION_MAP.at(type));
+    std::vector<byte> paddingBytes = FileManagementHelper::IntToBytes(padding, 2);
+    std::vector<byte> birthBytes = FileManagementHelper::IntToBytes(automaton.birth, 2);
+    std::vector<byte> surviveBytes = FileManagementHelper::IntToBytes(automaton.survive, 2);
+    std::vector<byte> flagsBytes = FileManagementHelper::IntToBytes(automaton.flags, 1);
+    std::vector<byte> sizeBytes = FileManagementHelper::IntToBytes(static_cast<int>(data.size()), 8);
+
+    buffer.insert(buffer.end(), magicString.begin(), magicString.end());    // magic string
+    buffer.insert(buffer.end(), versionBytes.begin(), versionBytes.end());  // version of the file
+    buffer.insert(buffer.end(), formatBytes.begin(), formatBytes.end());    // format of the data
+    buffer.insert(buffer.end(), paddingBytes.begin(), paddingBytes.end());  // padding of the data
+    buffer.insert(buffer.end(), birthBytes.begin(), birthBytes.end());      // birth mask of the rule
+    buffer.insert(buffer.end(), surviveBytes.begin(), surviveBytes.end());  // survive mask of the rule
+    buffer.insert(buffer.end(), flagsBytes.begin(), flagsBytes.end());      // automaton flags (topology)
+    buffer.insert(buffer.end(), sizeBytes.begin(), sizeBytes.end());        // size of the data
+
+    if (buffer.size() != HEADER_LENGTH) {
+        throw std::runtime_error("[e] Header length is incorrect: " + std::to_string(buffer.size()) +
+                                 " instead of " + std::to_string(HEADER_LENGTH));
+    }
+
+    return buffer;
+
+}
+
 std::vector<byte> DenisEncoder::GetHeader(std::vector<byte> &data, DenisExtensionType type, int padding) {
     // get the header for the given version
     switch (GetVersion()) {
@@ -99,6 +143,8 @@ std::vector<byte> DenisEncoder::GetHeader(std::vector<byte> &data, DenisExtensio
             return GetVersion1Header(data, type);
         case 2:
             return GetVersion2Header(data, type, padding);
+        case 3:
+            return GetVersion3Header(data, type, padding, automaton_);
         default:
             throw std::invalid_argument("[e] Unsupported version :" + std::to_string(GetVersion()));
     }
@@ -1,11 +1,153 @@
 #include <GPUCellularAutomaton.h>
+#include "EGLManager.h"
+#include "SnapshotChannel.h"
 #include <iostream>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "../shaders/gol_activity.h"
 #include "../shaders/gol_backward.h"
 #include "../shaders/gol_forward.h"
+#include "../shaders/gol_margolus.h"
+#include "../shaders/gol_stats.h"
 
+// Cached program binaries live in $XDG_CACHE_HOME/denis/programs (or ~/.cache/denis/programs),
+// one file per FNV-1a hash of the driver, renderer and specialised source. Empty when
+// there is no cache directory or the driver cannot save binaries
+std::filesystem::path program_cache_path(const char *source, int len) {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) {
+        return {};
+    }
+
+    std::filesystem::path dir;
+    if (const char *cache = std::getenv("XDG_CACHE_HOME"); cache && *cache) {
+        dir = cache;
+    } else if (const char *home = std::getenv("HOME"); home && *home) {
+        dir = std::filesystem::path(home) / ".cache";
+    } else {
+        return {};
+    }
+
+    // Each field ends with a byte no string contains, so they cannot run into each other
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](const char *bytes, size_t count) {
+        for (size_t i = 0; i <= count; i++) {
+            hash ^= i < count ? static_cast<uint8_t>(bytes[i]) : 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const char *value = reinterpret_cast<const char *>(glGetString(name));
+        mix(value ? value : "", value ? std::strlen(value) : 0);
+    }
+    mix(source, len);
+
+    char file[24];
+    std::snprintf(file, sizeof(file), "%016llx.bin", static_cast<unsigned long long>(hash));
+    return dir / "denis" / "programs" / file;
+}
+
+// Header of a cached program binary, followed by `length` bytes in the driver's `format`
+struct ProgramBinaryHeader {
+    char magic[4] = {'D', 'P', 'B', '1'};
+    uint32_t format = 0;
+    uint32_t length = 0;
+};
+
+// The cached program, or 0 if there is none or the driver rejects it (e.g. after an update)
+unsigned int load_program_binary(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    ProgramBinaryHeader header, expected;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) {
+        return 0;
+    }
+
+    // Entries are written whole: a length that is not the rest of the file means a corrupt one
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if (error || header.length == 0 || size - sizeof(header) != header.length) {
+        return 0;
+    }
+
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) {
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        glGetError();   // An unknown format raises an error too: it is handled by compiling
+        return 0;
+    }
+    return program;
+}
+
+// Saves a linked program's binary; the cache is best effort, so failures are ignored
+void store_program_binary(unsigned int program, const std::filesystem::path &path) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    ProgramBinaryHeader header;
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    header.format = format;
+    header.length = static_cast<uint32_t>(written);
+
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) {
+        return;
+    }
+
+    // Written aside then renamed, so concurrent runs never load half a file
+    std::filesystem::path temporary = path;
+    temporary += "." + std::to_string(getpid()) + "-" +
+                 std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+// Loads a compute program from the binary cache, or compiles it and caches its binary
 unsigned int load_compute_shader(const char* source, int len) {
+    const std::filesystem::path cached = program_cache_path(source, len);
+    if (!cached.empty()) {
+        if (unsigned int program = load_program_binary(cached)) {
+            return program;
+        }
+    }
+
     unsigned int compute_shader = glCreateShader(GL_COMPUTE_SHADER);
     glShaderSource(compute_shader, 1, &source, &len);
     glCompileShader(compute_shader);
@@ -21,6 +163,9 @@ unsigned int load_compute_shader(const char* source, int len) {
 
     unsigned int compute_program = glCreateProgram();
     glAttachShader(compute_program, compute_shader);
+    if (!cached.empty()) {
+        glProgramParameteri(compute_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(compute_program);
 
     glGetProgramiv(compute_program, GL_LINK_STATUS, &success);
@@ -32,12 +177,63 @@ unsigned int load_compute_shader(const char* source, int len) {
 
     glDeleteShader(compute_shader);
 
+    if (!cached.empty()) {
+        store_program_binary(compute_program, cached);
+    }
     return compute_program;
 }
 
-GPUCellularAutomaton::GPUCellularAutomaton() {
-    m_forward_shader_program = load_compute_shader(reinterpret_cast<char *>(gol_forward_glsl), gol_forward_glsl_len);
-    m_backward_shader_program = load_compute_shader(reinterpret_cast<char *>(gol_backward_glsl), gol_backward_glsl_len);
+// Inserts the rule and topology as preprocessor constants after the #version line,
+// so the driver compiles a kernel specialised for them
+std::string specialise_shader(const unsigned char *source, unsigned int len, const std::string &defines) {
+    std::string code(reinterpret_cast<const char *>(source), len);
+    size_t versionEnd = code.find('\n');
+    code.insert(versionEnd == std::string::npos ? code.size() : versionEnd + 1, defines);
+    return code;
+}
+
+std::string rule_defines(const AutomatonRule &rule) {
+    return "#define BIRTH_MASK " + std::to_string(rule.birth) + "\n" +
+           "#define SURVIVE_MASK " + std::to_string(rule.survive) + "\n" +
+           "#define TOROIDAL " + (rule.topology == Topology::Toroidal ? "1" : "0") + "\n" +
+           "#define TRACK_ACTIVITY " + (rule.birth & 1 ? "0" : "1") + "\n";
+}
+
+std::string block_defines(const BlockTable &table, Topology topology) {
+    std::string entries;
+    for (uint8_t entry : table) {
+        entries += (entries.empty() ? "" : ", ") + std::to_string(entry);
+    }
+    return "#define BLOCK_TABLE " + entries + "\n" +
+           "#define TOROIDAL " + (topology == Topology::Toroidal ? "1" : "0") + "\n";
+}
+
+GPUCellularAutomaton::GPUCellularAutomaton(const AutomatonRule &rule) {
+    EGLManager::init();
+
+    std::string forward, backward;
+    if (rule.neighbourhood == Neighbourhood::Margolus) {
+        // Going backward applies the inverse table to the same partition
+        m_block_rule = true;
+        forward = specialise_shader(gol_margolus_glsl, gol_margolus_glsl_len,
+                                    block_defines(rule.blockTable(), rule.topology));
+        backward = specialise_shader(gol_margolus_glsl, gol_margolus_glsl_len,
+                                     block_defines(rule.inverseBlockTable(), rule.topology));
+    } else {
+        forward = specialise_shader(gol_forward_glsl, gol_forward_glsl_len, rule_defines(rule));
+        backward = specialise_shader(gol_backward_glsl, gol_backward_glsl_len, rule_defines(rule));
+
+        // A dead neighbourhood stays dead unless dead cells with no live neighbour are born
+        m_track_activity = !(rule.birth & 1);
+        if (m_track_activity) {
+            std::string activity = specialise_shader(gol_activity_glsl, gol_activity_glsl_len,
+                                                     rule_defines(rule));
+            m_activity_shader_program = load_compute_shader(activity.c_str(), static_cast<int>(activity.size()));
+        }
+    }
+    m_forward_shader_program = load_compute_shader(forward.c_str(), static_cast<int>(forward.size()));
+    m_backward_shader_program = load_compute_shader(backward.c_str(), static_cast<int>(backward.size()));
+    m_stats_shader_program = load_compute_shader(reinterpret_cast<char *>(gol_stats_glsl), gol_stats_glsl_len);
     glGenBuffers(3, m_buffers);
 
     // Initialize both buffers with the proper size
@@ -46,69 +242,185 @@ GPUCellularAutomaton::GPUCellularAutomaton() {
         glBufferData(GL_SHADER_STORAGE_BUFFER, BUFFER_SIZE * sizeof(GLint), nullptr, GL_DYNAMIC_COPY);
     }
 
+    // Until the grids are written, every tile may be live: all flags match the initial stamps
+    if (m_track_activity) {
+        glGenBuffers(1, &m_activity_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_activity_buffer);
+        std::vector<GLuint> allLive(3 * TILES, 0);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, allLive.size() * sizeof(GLuint), allLive.data(), GL_DYNAMIC_COPY);
+
+        // Indirect dispatch size, then the list of tiles
+        glGenBuffers(1, &m_active_tiles_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_active_tiles_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (3 + TILES) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+    }
+
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Staging buffers receive both grids (current, then previous) for readback
+    for (StagingBuffer &staging : m_staging) {
+        glGenBuffers(1, &staging.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, staging.buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, 2 * BUFFER_SIZE * sizeof(GLint), nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 }
 
 GPUCellularAutomaton::~GPUCellularAutomaton() {
+    for (StagingBuffer &staging : m_staging) {
+        if (staging.fence) {
+            glDeleteSync(staging.fence);
+        }
+        glDeleteBuffers(1, &staging.buffer);
+    }
+
+    if (m_stats_buffer) {
+        glDeleteBuffers(1, &m_stats_buffer);
+    }
+
     glDeleteBuffers(3, m_buffers);
+    if (m_track_activity) {
+        glDeleteBuffers(1, &m_activity_buffer);
+        glDeleteBuffers(1, &m_active_tiles_buffer);
+        glDeleteProgram(m_activity_shader_program);
+    }
     glDeleteProgram(m_forward_shader_program);
     glDeleteProgram(m_backward_shader_program);
+    glDeleteProgram(m_stats_shader_program);
 }
 
 void GPUCellularAutomaton::runForward() {
+    if (m_block_rule) {
+        runBlocks(m_forward_shader_program, m_generation++ & 1);
+        return;
+    }
+
+    runMoore(m_forward_shader_program, m_current_buffer, m_prev_buffer);
+
+    // Rotate buffers: (prev -> current, current -> next, next -> prev)
+    std::swap(m_prev_buffer, m_current_buffer);
+    std::swap(m_current_buffer, m_next_buffer);
+}
+
+void GPUCellularAutomaton::runBackward() {
+    if (m_block_rule) {
+        runBlocks(m_backward_shader_program, --m_generation & 1);
+        return;
+    }
+
+    runMoore(m_backward_shader_program, m_prev_buffer, m_current_buffer);
+
+    // Rotate buffers: (prev <- current, current <- next, next <- prev)
+    std::swap(m_current_buffer, m_next_buffer);
+    std::swap(m_prev_buffer, m_current_buffer);
+}
+
+void GPUCellularAutomaton::runMoore(unsigned int program, int source, int other) {
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[m_prev_buffer]);  // S(t-1)
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[m_current_buffer]); // S(t)
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_buffers[m_next_buffer]); // S(t+1)
 
-    glUseProgram(m_forward_shader_program);
+    if (!m_track_activity) {
+        glUseProgram(program);
+        glDispatchCompute(SIDE / 16, SIDE / 16, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        return;
+    }
 
-    glDispatchCompute(SIDE / 16, SIDE / 16, 1);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_activity_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_active_tiles_buffer);
 
+    // List the tiles that may be live, or were live and must be cleared
+    glUseProgram(m_activity_shader_program);
+    glUniform3i(0, source, other, m_next_buffer);
+    glUniform3ui(1, m_activity_stamps[source], m_activity_stamps[other], m_activity_stamps[m_next_buffer]);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // The step stamps the flags of the tiles it leaves live, the others go stale
+    m_activity_stamps[m_next_buffer] = m_next_stamp++;
+
+    glUseProgram(program);
+    glUniform1i(0, m_next_buffer);
+    glUniform1ui(1, m_activity_stamps[m_next_buffer]);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_active_tiles_buffer);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
 
-    // Rotate buffers: (prev -> current, current -> next, next -> prev)
-    std::swap(m_prev_buffer, m_current_buffer);
-    std::swap(m_current_buffer, m_next_buffer);
+void GPUCellularAutomaton::writeActivity(int buffer, const GLint *cells) {
+    if (!m_track_activity) {
+        return;
+    }
+
+    const GLuint stamp = m_next_stamp++;
+    m_activity_stamps[buffer] = stamp;
+
+    std::array<GLuint, TILES> flags{};
+    if (cells) {
+        for (int i = 0; i < BUFFER_SIZE; i++) {
+            if (cells[i]) {
+                flags[(i / SIDE / 16) * (SIDE / 16) + (i % SIDE) / 16] = stamp;
+            }
+        }
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_activity_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, buffer * TILES * sizeof(GLuint), sizeof(flags), flags.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void GPUCellularAutomaton::runBackward() {
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[m_prev_buffer]);  // S(t-1)
+void GPUCellularAutomaton::runBlocks(unsigned int program, int phase) {
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[m_current_buffer]); // S(t)
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_buffers[m_next_buffer]); // S(t+1)
 
-    glUseProgram(m_backward_shader_program);
+    glUseProgram(program);
+    glUniform1i(0, phase);
 
-    glDispatchCompute(SIDE / 16, SIDE / 16, 1);
+    // One invocation per 2x2 block
+    glDispatchCompute(SIDE / 32, SIDE / 32, 1);
 
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-    // Rotate buffers: (prev <- current, current <- next, next <- prev)
-    std::swap(m_current_buffer, m_next_buffer);
+    // Rotate buffers in both directions, so the previous grid keeps the generation just left
     std::swap(m_prev_buffer, m_current_buffer);
+    std::swap(m_current_buffer, m_next_buffer);
 }
 
-void GPUCellularAutomaton::clearPrevGrid() const {
+void GPUCellularAutomaton::setGeneration(int generation) {
+    m_generation = generation;
+}
+
+void GPUCellularAutomaton::clearPrevGrid() {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[m_prev_buffer]);
     GLint* data = (GLint*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_WRITE_ONLY);
     assert(data != nullptr);
     memset(data, 0, BUFFER_SIZE * sizeof(GLint));
     glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    writeActivity(m_prev_buffer, nullptr);
 }
 
-void GPUCellularAutomaton::writeCurrGrid(std::array<GLint, BUFFER_SIZE>& currGrid) const {
+void GPUCellularAutomaton::writeCurrGrid(const std::array<GLint, BUFFER_SIZE>& currGrid) {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[m_current_buffer]);
     glBufferData(GL_SHADER_STORAGE_BUFFER, currGrid.size() * sizeof(GLint), currGrid.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    writeActivity(m_current_buffer, currGrid.data());
 }
 
-void GPUCellularAutomaton::writePrevGrid(std::array<GLint, BUFFER_SIZE>& prev_grid) const {
+void GPUCellularAutomaton::writePrevGrid(const std::array<GLint, BUFFER_SIZE>& prev_grid) {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[m_prev_buffer]);
     glBufferData(GL_SHADER_STORAGE_BUFFER, prev_grid.size() * sizeof(GLint), prev_grid.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    writeActivity(m_prev_buffer, prev_grid.data());
 }
 
-void GPUCellularAutomaton::readCurrGrid(std::array<GLint, BUFFER_SIZE>& currGrid) const {
+void GPUCellularAutomaton::readCurrGrid(std::array<GLint, BUFFER_SIZE>& currGrid) {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[m_current_buffer]);
     GLint* ptr = (GLint*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
     if (ptr) {
@@ -118,7 +430,7 @@ void GPUCellularAutomaton::readCurrGrid(std::array<GLint, BUFFER_SIZE>& currGrid
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
-void GPUCellularAutomaton::readPrevGrid(std::array<GLint, BUFFER_SIZE>& prevGrid) const {
+void GPUCellularAutomaton::readPrevGrid(std::array<GLint, BUFFER_SIZE>& prevGrid) {
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[m_prev_buffer]);
     GLint* ptr = (GLint*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
     if (ptr) {
@@ -128,3 +440,119 @@ void GPUCellularAutomaton::readPrevGrid(std::array<GLint, BUFFER_SIZE>& prevGrid
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
+
+bool GPUCellularAutomaton::requestSnapshot(int tag) {
+    StagingBuffer &staging = m_staging[m_staging_head];
+    if (staging.fence) {
+        return false;
+    }
+
+    constexpr GLsizeiptr gridBytes = BUFFER_SIZE * sizeof(GLint);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, staging.buffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_buffers[m_current_buffer]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, gridBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_buffers[m_prev_buffer]);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, gridBytes, gridBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    staging.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    staging.tag = tag;
+    m_staging_head = (m_staging_head + 1) % STAGING_BUFFERS;
+    return true;
+}
+
+bool GPUCellularAutomaton::pollSnapshot(PackedGrid &currGrid, PackedGrid &prevGrid, int &tag, bool wait) {
+    constexpr GLuint64 waitTimeout = 1000000000; // 1 s, in nanoseconds
+
+    // Fences signal in order: retire every finished copy, keeping only the newest
+    int ready = -1;
+    while (m_staging[m_staging_tail].fence) {
+        StagingBuffer &staging = m_staging[m_staging_tail];
+        GLenum status = glClientWaitSync(staging.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? waitTimeout : 0);
+        if (status == GL_TIMEOUT_EXPIRED && wait) {
+            continue;
+        }
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        glDeleteSync(staging.fence);
+        staging.fence = nullptr;
+        ready = m_staging_tail;
+        m_staging_tail = (m_staging_tail + 1) % STAGING_BUFFERS;
+    }
+
+    if (ready < 0) {
+        return false;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, m_staging[ready].buffer);
+    auto *cells = static_cast<const GLint *>(
+        glMapBufferRange(GL_COPY_READ_BUFFER, 0, 2 * BUFFER_SIZE * sizeof(GLint), GL_MAP_READ_BIT));
+    if (cells) {
+        packGrid(cells, currGrid);
+        packGrid(cells + BUFFER_SIZE, prevGrid);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        tag = m_staging[ready].tag;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    return cells != nullptr;
+}
+
+void GPUCellularAutomaton::beginStats(int generations) {
+    if (!m_stats_buffer) {
+        glGenBuffers(1, &m_stats_buffer);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_stats_buffer);
+    if (generations > m_stats_capacity) {
+        m_stats_capacity = generations;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_stats_capacity * sizeof(GenerationStats), nullptr, GL_DYNAMIC_READ);
+    }
+
+    // The shader accumulates into its slot, so every slot starts at zero
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_stats_count = 0;
+}
+
+void GPUCellularAutomaton::recordStats() {
+    if (m_stats_count >= m_stats_capacity) {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[m_prev_buffer]);  // S(t-1)
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[m_current_buffer]); // S(t)
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_stats_buffer);
+
+    glUseProgram(m_stats_shader_program);
+    glUniform1i(0, m_stats_count++);
+
+    // 256 invocations per workgroup, 4 cells per invocation
+    glDispatchCompute(BUFFER_SIZE / 1024, 1, 1);
+
+    // The next step overwrites S(t-1), which this reduction still reads
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+std::vector<GenerationStats> GPUCellularAutomaton::readStats() const {
+    std::vector<GenerationStats> stats(m_stats_count);
+    if (stats.empty()) {
+        return stats;
+    }
+
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_stats_buffer);
+    auto *counts = static_cast<const GenerationStats *>(
+        glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, stats.size() * sizeof(GenerationStats), GL_MAP_READ_BIT));
+    if (counts) {
+        std::memcpy(stats.data(), counts, stats.size() * sizeof(GenerationStats));
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    return stats;
+}
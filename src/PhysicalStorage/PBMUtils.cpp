@@ -1,50 +1,319 @@
 #include "PhysicalStorage/PBMUtils.h"
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace PhysicalStorage {
+    namespace {
+        // Read-only memory mapping of a whole file, unmapped on destruction
+        struct MappedFile {
+            const uint8_t *data = nullptr;
+            size_t size = 0;
+
+            explicit MappedFile(const std::string &filename) {
+                int fd = open(filename.c_str(), O_RDONLY);
+                if (fd < 0) return;
+
+                struct stat st{};
+                if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (ptr != MAP_FAILED) {
+                        madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+                        data = static_cast<const uint8_t *>(ptr);
+                        size = st.st_size;
+                    }
+                }
+                close(fd);
+            }
+
+            ~MappedFile() {
+                if (data) munmap(const_cast<uint8_t *>(data), size);
+            }
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+        };
+
+        // Bit reversal table, used to turn LSB-first SIMD masks into MSB-first PBM bytes
+        constexpr std::array<uint8_t, 256> REVERSED_BITS = [] {
+            std::array<uint8_t, 256> table{};
+            for (int i = 0; i < 256; i++) {
+                uint8_t r = 0;
+                for (int b = 0; b < 8; b++) {
+                    if (i & (1 << b)) r |= 0x80 >> b;
+                }
+                table[i] = r;
+            }
+            return table;
+        }();
+
+        // Skips whitespace and '#' comments in a PBM header
+        size_t skipSeparators(const uint8_t *data, size_t size, size_t pos) {
+            while (pos < size) {
+                if (data[pos] == '#') {
+                    while (pos < size && data[pos] != '\n') pos++;
+                } else if (std::isspace(data[pos])) {
+                    pos++;
+                } else {
+                    break;
+                }
+            }
+            return pos;
+        }
+
+        // Parses a decimal header field
+        size_t readHeaderInt(const uint8_t *data, size_t size, size_t pos, int &value) {
+            value = 0;
+            pos = skipSeparators(data, size, pos);
+            size_t start = pos;
+            while (pos < size && std::isdigit(data[pos]) && value < (1 << 24)) {
+                value = value * 10 + (data[pos++] - '0');
+            }
+            if (pos == start) value = -1;
+            return pos;
+        }
+
+        // Parses a P4 header, returns the offset of the raster (0 on error)
+        size_t readP4Header(const MappedFile &file, int &width, int &height) {
+            if (file.size < 2 || file.data[0] != 'P' || file.data[1] != '4') {
+                return 0;
+            }
+
+            size_t pos = readHeaderInt(file.data, file.size, 2, width);
+            pos = readHeaderInt(file.data, file.size, pos, height);
+
+            // Exactly one whitespace character separates the header from the raster
+            if (pos >= file.size || !std::isspace(file.data[pos])) {
+                return 0;
+            }
+            return pos + 1;
+        }
+
+        // Parses an ASCII (P1) PBM file
+        std::vector<uint8_t> parseP1File(const std::string &filename, int &width, int &height) {
+            std::ifstream file(filename);
+            if (!file) {
+                std::cerr << "Cannot open PBM file: " << filename << std::endl;
+                return {};
+            }
+
+            // Read PBM header
+            std::string line;
+            std::getline(file, line); // P1 format identifier
+            if (line != "P1") {
+                std::cerr << "Not a valid PBM (P1) file" << std::endl;
+                return {};
+            }
+
+            // Skip comments
+            do {
+                std::getline(file, line);
+            } while (line[0] == '#');
+
+            // Parse width and height
+            std::istringstream iss(line);
+            iss >> width >> height;
+
+            if (width <= 0 || height <= 0) {
+                std::cerr << "Invalid PBM dimensions: " << width << "x" << height << std::endl;
+                return {};
+            }
+
+            // Read the data
+            std::vector<uint8_t> data;
+            data.reserve(width * height);
+
+            int value;
+            while (file >> value) {
+                data.push_back(static_cast<uint8_t>(value));
+            }
+
+            if (data.size() != static_cast<size_t>(width * height)) {
+                std::cerr << "PBM data size mismatch. Expected " << (width * height)
+                        << " values, got " << data.size() << std::endl;
+            }
+
+            return data;
+        }
+
+        // Maps a P4 PBM file and returns its raster, or nullptr on error
+        const uint8_t *mapP4Raster(const MappedFile &file, const std::string &filename, int &width, int &height) {
+            if (!file.data) {
+                std::cerr << "Cannot open PBM file: " << filename << std::endl;
+                return nullptr;
+            }
+
+            size_t offset = readP4Header(file, width, height);
+            if (offset == 0 || width <= 0 || height <= 0) {
+                std::cerr << "Invalid PBM (P4) header in " << filename << std::endl;
+                return nullptr;
+            }
+
+            size_t stride = (static_cast<size_t>(width) + 7) / 8;
+            if (file.size - offset < stride * height) {
+                std::cerr << "PBM data size mismatch. Expected " << stride * height
+                        << " bytes, got " << file.size - offset << std::endl;
+                return nullptr;
+            }
+
+            return file.data + offset;
+        }
+
+        bool writeP4(const std::string &filename, int width, int height,
+                     const std::function<void(int, uint8_t *)> &fillRow) {
+            std::ofstream file(filename, std::ios::binary);
+            if (!file) {
+                std::cerr << "Cannot open PBM file for writing: " << filename << std::endl;
+                return false;
+            }
+
+            file << "P4\n" << width << " " << height << "\n";
+
+            size_t stride = (static_cast<size_t>(width) + 7) / 8;
+            std::vector<uint8_t> raster(stride * height);
+            for (int y = 0; y < height; y++) {
+                fillRow(y, raster.data() + y * stride);
+            }
+
+            file.write(reinterpret_cast<const char *>(raster.data()), raster.size());
+            return static_cast<bool>(file);
+        }
+    }
+
+    void PBMUtils::unpackRow(const uint8_t *packed, uint8_t *out, size_t width) {
+        size_t byte = 0;
+
+#if defined(__SSE2__)
+        // 16 packed bytes expand to 128 pixels: broadcast each byte to 8 lanes,
+        // then test one bit per lane
+        const __m128i bitMask = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1,
+                                              -128, 64, 32, 16, 8, 4, 2, 1);
+        const __m128i one = _mm_set1_epi8(1);
+
+        for (; (byte + 16) * 8 <= width; byte += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + byte));
+            __m128i pairs[2] = {_mm_unpacklo_epi8(bytes, bytes), _mm_unpackhi_epi8(bytes, bytes)};
+
+            for (int p = 0; p < 2; p++) {
+                __m128i quads[2] = {_mm_unpacklo_epi16(pairs[p], pairs[p]), _mm_unpackhi_epi16(pairs[p], pairs[p])};
+                for (int q = 0; q < 2; q++) {
+                    __m128i octets[2] = {_mm_unpacklo_epi32(quads[q], quads[q]),
+                                         _mm_unpackhi_epi32(quads[q], quads[q])};
+                    for (int o = 0; o < 2; o++) {
+                        __m128i bits = _mm_cmpeq_epi8(_mm_and_si128(octets[o], bitMask), bitMask);
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (byte + p * 8 + q * 4 + o * 2) * 8),
+                                         _mm_and_si128(bits, one));
+                    }
+                }
+            }
+        }
+#endif
+
+        for (size_t x = byte * 8; x < width; x++) {
+            out[x] = (packed[x / 8] >> (7 - x % 8)) & 1;
+        }
+    }
+
+    void PBMUtils::packRow(const uint8_t *pixels, uint8_t *out, size_t width) {
+        size_t x = 0;
+
+#if defined(__SSE2__)
+        // Compare 16 pixels against zero and gather the lanes with movemask
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + x));
+            int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(values, zero));
+            out[x / 8] = REVERSED_BITS[mask & 0xFF];
+            out[x / 8 + 1] = REVERSED_BITS[(mask >> 8) & 0xFF];
+        }
+#endif
+
+        std::memset(out + x / 8, 0, (width + 7) / 8 - x / 8);
+        for (; x < width; x++) {
+            if (pixels[x]) out[x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+
     // Parse a PBM file into a bit matrix
     std::vector<uint8_t> PBMUtils::parsePBMFile(const std::string &filename, int &width, int &height) {
-        std::ifstream file(filename);
-        if (!file) {
-            std::cerr << "Cannot open PBM file: " << filename << std::endl;
-            return {};
+        MappedFile file(filename);
+        if (file.size >= 2 && file.data[0] == 'P' && file.data[1] == '1') {
+            return parseP1File(filename, width, height);
         }
 
-        // Read PBM header
-        std::string line;
-        std::getline(file, line); // P1 format identifier
-        if (line != "P1") {
-            std::cerr << "Not a valid PBM (P1) file" << std::endl;
+        const uint8_t *raster = mapP4Raster(file, filename, width, height);
+        if (!raster) {
             return {};
         }
 
-        // Skip comments
-        do {
-            std::getline(file, line);
-        } while (line[0] == '#');
+        size_t stride = (static_cast<size_t>(width) + 7) / 8;
+        std::vector<uint8_t> data(static_cast<size_t>(width) * height);
+        for (int y = 0; y < height; y++) {
+            unpackRow(raster + y * stride, data.data() + static_cast<size_t>(y) * width, width);
+        }
+
+        return data;
+    }
 
-        // Parse width and height
-        std::istringstream iss(line);
-        iss >> width >> height;
+    // Parse a PBM file into packed rows
+    std::vector<uint8_t> PBMUtils::parsePBMFilePacked(const std::string &filename, int &width, int &height) {
+        MappedFile file(filename);
+        if (file.size >= 2 && file.data[0] == 'P' && file.data[1] == '1') {
+            std::vector<uint8_t> pixels = parseP1File(filename, width, height);
+            if (pixels.size() != static_cast<size_t>(width) * height) {
+                return {};
+            }
 
-        if (width <= 0 || height <= 0) {
-            std::cerr << "Invalid PBM dimensions: " << width << "x" << height << std::endl;
+            size_t stride = (static_cast<size_t>(width) + 7) / 8;
+            std::vector<uint8_t> packed(stride * height);
+            for (int y = 0; y < height; y++) {
+                packRow(pixels.data() + static_cast<size_t>(y) * width, packed.data() + y * stride, width);
+            }
+            return packed;
+        }
+
+        const uint8_t *raster = mapP4Raster(file, filename, width, height);
+        if (!raster) {
             return {};
         }
 
-        // Read the data
-        std::vector<uint8_t> data;
-        data.reserve(width * height);
+        // P4 rows are already in the packed layout
+        size_t stride = (static_cast<size_t>(width) + 7) / 8;
+        return {raster, raster + stride * height};
+    }
 
-        int value;
-        while (file >> value) {
-            data.push_back(static_cast<uint8_t>(value));
+    bool PBMUtils::writePBMFile(const std::string &filename, const std::vector<uint8_t> &data, int width,
+                                int height) {
+        if (width <= 0 || height <= 0 || data.size() < static_cast<size_t>(width) * height) {
+            std::cerr << "Invalid PBM dimensions: " << width << "x" << height << std::endl;
+            return false;
         }
 
-        if (data.size() != static_cast<size_t>(width * height)) {
-            std::cerr << "PBM data size mismatch. Expected " << (width * height)
-                    << " values, got " << data.size() << std::endl;
+        return writeP4(filename, width, height, [&](int y, uint8_t *row) {
+            packRow(data.data() + static_cast<size_t>(y) * width, row, width);
+        });
+    }
+
+    bool PBMUtils::writePBMFilePacked(const std::string &filename, const std::vector<uint8_t> &packed, int width,
+                                      int height) {
+        size_t stride = (static_cast<size_t>(width) + 7) / 8;
+        if (width <= 0 || height <= 0 || packed.size() < stride * height) {
+            std::cerr << "Invalid PBM dimensions: " << width << "x" << height << std::endl;
+            return false;
         }
 
-        return data;
+        return writeP4(filename, width, height, [&](int y, uint8_t *row) {
+            std::memcpy(row, packed.data() + y * stride, stride);
+        });
     }
-}
\ No newline at end of file
+}
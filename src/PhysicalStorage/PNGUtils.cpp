@@ -0,0 +1,162 @@
+#include "PhysicalStorage/PNGUtils.h"
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace PhysicalStorage {
+    namespace {
+        // Uncompressed bytes per row group, as in pigz
+        constexpr size_t GROUP_BYTES = 128 * 1024;
+
+        struct CompressedGroup {
+            std::vector<uint8_t> data;
+            uLong adler = 1;
+            size_t rawSize = 0;
+        };
+
+        void appendBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+            out.push_back(value >> 24);
+            out.push_back(value >> 16);
+            out.push_back(value >> 8);
+            out.push_back(value);
+        }
+
+        void appendChunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data) {
+            appendBigEndian(out, static_cast<uint32_t>(data.size()));
+            size_t typeOffset = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data.begin(), data.end());
+
+            uLong crc = crc32(0L, out.data() + typeOffset, static_cast<uInt>(out.size() - typeOffset));
+            appendBigEndian(out, static_cast<uint32_t>(crc));
+        }
+
+        // Deflates one row group as a raw stream; every group but the last ends with a
+        // sync flush so the streams can be concatenated
+        bool compressGroup(const std::vector<uint8_t> &raw, bool last, CompressedGroup &group) {
+            z_stream stream{};
+            if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+
+            group.data.resize(deflateBound(&stream, raw.size()) + 16);
+            stream.next_in = const_cast<Bytef *>(raw.data());
+            stream.avail_in = static_cast<uInt>(raw.size());
+            stream.next_out = group.data.data();
+            stream.avail_out = static_cast<uInt>(group.data.size());
+
+            int ret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            bool ok = last ? ret == Z_STREAM_END : ret == Z_OK && stream.avail_in == 0;
+
+            group.data.resize(stream.total_out);
+            group.adler = adler32(1L, raw.data(), static_cast<uInt>(raw.size()));
+            group.rawSize = raw.size();
+
+            deflateEnd(&stream);
+            return ok;
+        }
+    }
+
+    bool PNGUtils::writeGreyscalePNG(const std::string &filename, const std::vector<uint8_t> &packed, int width,
+                                     int height, int bitDepth, unsigned int threads) {
+        if (bitDepth != 1 && bitDepth != 2 && bitDepth != 4 && bitDepth != 8) {
+            std::cerr << "Unsupported PNG bit depth: " << bitDepth << std::endl;
+            return false;
+        }
+
+        const size_t stride = (static_cast<size_t>(width) * bitDepth + 7) / 8;
+        if (width <= 0 || height <= 0 || packed.size() < stride * height) {
+            std::cerr << "Invalid PNG dimensions: " << width << "x" << height << std::endl;
+            return false;
+        }
+
+        // Split the scanlines (filter byte + row) into independent groups
+        const size_t rowsPerGroup = std::max<size_t>(1, GROUP_BYTES / (stride + 1));
+        const size_t groupCount = (height + rowsPerGroup - 1) / rowsPerGroup;
+        std::vector<CompressedGroup> groups(groupCount);
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min<unsigned int>(threads, groupCount);
+
+        std::atomic<size_t> nextGroup{0};
+        std::atomic<bool> failed{false};
+
+        auto worker = [&]() {
+            std::vector<uint8_t> raw;
+            for (size_t g = nextGroup++; g < groupCount; g = nextGroup++) {
+                size_t firstRow = g * rowsPerGroup;
+                size_t lastRow = std::min<size_t>(firstRow + rowsPerGroup, height);
+
+                raw.clear();
+                for (size_t y = firstRow; y < lastRow; y++) {
+                    raw.push_back(0); // Filter type: None
+                    raw.insert(raw.end(), packed.begin() + y * stride, packed.begin() + (y + 1) * stride);
+                }
+
+                if (!compressGroup(raw, g + 1 == groupCount, groups[g])) {
+                    failed.store(true);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < threads; i++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &t : workers) {
+            t.join();
+        }
+
+        if (failed.load()) {
+            std::cerr << "Failed to compress PNG data" << std::endl;
+            return false;
+        }
+
+        // zlib stream: header, concatenated deflate groups, combined Adler-32
+        std::vector<uint8_t> idat = {0x78, 0x9C};
+        uLong adler = 1;
+        for (const auto &group : groups) {
+            idat.insert(idat.end(), group.data.begin(), group.data.end());
+            adler = adler32_combine(adler, group.adler, static_cast<z_off_t>(group.rawSize));
+        }
+        appendBigEndian(idat, static_cast<uint32_t>(adler));
+
+        std::vector<uint8_t> ihdr;
+        appendBigEndian(ihdr, static_cast<uint32_t>(width));
+        appendBigEndian(ihdr, static_cast<uint32_t>(height));
+        ihdr.push_back(static_cast<uint8_t>(bitDepth));
+        ihdr.push_back(0); // Colour type: greyscale
+        ihdr.push_back(0); // Compression method
+        ihdr.push_back(0); // Filter method
+        ihdr.push_back(0); // Interlace method
+
+        std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        appendChunk(png, "IHDR", ihdr);
+        appendChunk(png, "IDAT", idat);
+        appendChunk(png, "IEND", {});
+
+        std::ofstream file(filename, std::ios::binary);
+        if (!file) {
+            std::cerr << "Cannot open PNG file for writing: " << filename << std::endl;
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char *>(png.data()), png.size());
+        return static_cast<bool>(file);
+    }
+
+    bool PNGUtils::writeBilevelPNG(const std::string &filename, const std::vector<uint8_t> &packed, int width,
+                                   int height, unsigned int threads) {
+        // PNG greyscale uses 0 for black, the packed matrix uses 1
+        std::vector<uint8_t> inverted(packed.size());
+        std::transform(packed.begin(), packed.end(), inverted.begin(), [](uint8_t b) {
+            return static_cast<uint8_t>(~b);
+        });
+
+        return writeGreyscalePNG(filename, inverted, width, height, 1, threads);
+    }
+}
@@ -1,33 +1,205 @@
 #include "PhysicalStorage/QRCodeStorage.hpp"
 #include "PhysicalStorage/HammingCode.h"
+#include "PhysicalStorage/PBMUtils.h"
+#include "PhysicalStorage/PNGUtils.h"
+#include "PhysicalStorage/ScanIngest.h"
+#include "FormatManager/FileManagementHelper.hpp"
+#include <qrencode.h>
+#include <zbar.h>
 #include <bitset>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 
 
 namespace PhysicalStorage {
+    namespace {
+        // Hamming codeword length, i.e. modules per row of a two-level page
+        const int CODEWORD_BITS = static_cast<int>(HammingCode::encodeByte(0).size());
 
-    // Creates a QR code from binary data and writes it to a file
-    bool QRCodeStorage::fileToQR(const std::string &in, const std::string &out) {
+        int bitsPerModule(int levels) {
+            switch (levels) {
+                case 2: return 1;
+                case 4: return 2;
+                case 8: return 3;
+                default: return 0;
+            }
+        }
 
-        // Read data from file
-        std::vector<uint8_t> data;
+        // Level 0 is white, the last level black; adjacent levels carry Gray-coded
+        // values one bit apart, so misreading a level by one flips a single bit
+        uint8_t valueForLevel(uint8_t level) {
+            return level ^ (level >> 1);
+        }
+
+        uint8_t levelForValue(uint8_t value) {
+            uint8_t level = value;
+            for (uint8_t shift = value >> 1; shift; shift >>= 1) level ^= shift;
+            return level;
+        }
+
+        uint8_t greyForLevel(int level, int levels) {
+            return static_cast<uint8_t>(255 - level * 255 / (levels - 1));
+        }
+
+        /*
+         * Multi-level page layout (k bits per module, 12 / k modules per row):
+         *   row 0                      sync bar, all black
+         *   calibration rows           levels 0..L-1 in order, repeated to fill the rows
+         *   data rows                  groups of k codewords over k rows; module t of a
+         *                              group carries bit t of each of the k codewords
+         *   last row                   sync bar, all black
+         * Interleaving keeps any single misread module to one bit error per codeword,
+         * which the Hamming code corrects whatever the level distance.
+         */
+        std::vector<uint8_t> buildLevelPage(const std::vector<uint8_t> &data, int levels, int &width, int &height) {
+            const int k = bitsPerModule(levels);
+            width = CODEWORD_BITS / k;
+            const int calibrationRows = (levels + width - 1) / width;
+
+            std::vector<uint8_t> payload = FileManagementHelper::IntToBytes(
+                static_cast<int64_t>(data.size()), Constants::LEVEL_PAGE_LENGTH_BYTES);
+            payload.insert(payload.end(), data.begin(), data.end());
+            payload.resize((payload.size() + k - 1) / k * k, 0);
+
+            height = 1 + calibrationRows + static_cast<int>(payload.size()) + 1;
+            std::vector<uint8_t> page(static_cast<size_t>(width) * height, 0);
+
+            std::fill_n(page.begin(), width, levels - 1);
+            std::fill_n(page.end() - width, width, levels - 1);
+            for (int i = 0; i < calibrationRows * width; i++) {
+                page[width + i] = i % levels;
+            }
+
+            uint8_t *dataRows = page.data() + static_cast<size_t>(1 + calibrationRows) * width;
+            for (size_t group = 0; group < payload.size() / k; group++) {
+                std::vector<std::vector<bool>> codewords;
+                for (int i = 0; i < k; i++) {
+                    codewords.push_back(HammingCode::encodeByte(payload[group * k + i]));
+                }
+
+                for (int t = 0; t < CODEWORD_BITS; t++) {
+                    uint8_t value = 0;
+                    for (int i = 0; i < k; i++) {
+                        value |= codewords[i][t] << (k - 1 - i);
+                    }
+                    dataRows[group * CODEWORD_BITS + t] = levelForValue(value);
+                }
+            }
+
+            return page;
+        }
+
+        // Classifies the modules of a multi-level page against its calibration rows
+        bool readLevelPage(const std::vector<uint8_t> &grey, int width, int height, std::vector<uint8_t> &data) {
+            const int k = CODEWORD_BITS / width;
+            const int levels = 1 << k;
+            const int calibrationRows = (levels + width - 1) / width;
+            const int dataRows = height - calibrationRows - 2;
+
+            if (dataRows <= 0 || dataRows % k != 0) {
+                std::cerr << "Invalid multi-level page height: " << height << std::endl;
+                return false;
+            }
+
+            std::vector<double> levelGrey(levels, 0.0), levelCount(levels, 0.0);
+            for (int i = 0; i < calibrationRows * width; i++) {
+                levelGrey[i % levels] += grey[width + i];
+                levelCount[i % levels] += 1.0;
+            }
+            for (int l = 0; l < levels; l++) {
+                levelGrey[l] /= levelCount[l];
+            }
+
+            std::vector<uint8_t> payload;
+            const uint8_t *rows = grey.data() + static_cast<size_t>(1 + calibrationRows) * width;
+            std::vector<std::vector<bool>> codewords(k, std::vector<bool>(CODEWORD_BITS));
+
+            for (int group = 0; group < dataRows / k; group++) {
+                for (int t = 0; t < CODEWORD_BITS; t++) {
+                    uint8_t sample = rows[group * CODEWORD_BITS + t];
+                    int level = 0;
+                    for (int l = 1; l < levels; l++) {
+                        if (std::abs(sample - levelGrey[l]) < std::abs(sample - levelGrey[level])) level = l;
+                    }
+
+                    uint8_t value = valueForLevel(level);
+                    for (int i = 0; i < k; i++) {
+                        codewords[i][t] = (value >> (k - 1 - i)) & 1;
+                    }
+                }
+
+                for (int i = 0; i < k; i++) {
+                    payload.push_back(HammingCode::decodeByte(codewords[i]));
+                }
+            }
+
+            int64_t length = FileManagementHelper::BytesToInt(payload, Constants::LEVEL_PAGE_LENGTH_BYTES);
+            if (length < 0 || static_cast<size_t>(length) > payload.size() - Constants::LEVEL_PAGE_LENGTH_BYTES) {
+                std::cerr << "Invalid multi-level page data length: " << length << std::endl;
+                return false;
+            }
+
+            auto begin = payload.begin() + Constants::LEVEL_PAGE_LENGTH_BYTES;
+            data.assign(begin, begin + length);
+            return true;
+        }
+    }
 
+    // Creates a QR code from a file and writes it to a file
+    bool QRCodeStorage::fileToQR(const std::string &in, const std::string &out, int levels) {
         std::ifstream file(in, std::ios::binary);
         if (!file) {
             std::cerr << "Cannot open file: " << in << std::endl;
             return false;
         }
+        file.close();
 
-        // Read data from file
-        uint8_t byte;
-        while (file.read(reinterpret_cast<char *>(&byte), sizeof(byte))) {
-            data.push_back(byte);
-        }
+        return bytesToQR(FileManagementHelper::ReadBuffer(in), out, levels);
+    }
 
+    // Creates a QR code from binary data and writes it to a file
+    bool QRCodeStorage::bytesToQR(const std::vector<uint8_t> &data, const std::string &out, int levels) {
         if (data.empty()) {
             std::cerr << "Cannot create QR code: Empty data" << std::endl;
             return false;
         }
 
+        if (bitsPerModule(levels) == 0) {
+            std::cerr << "Unsupported number of module levels: " << levels << std::endl;
+            return false;
+        }
+
+        if (levels > 2) {
+            if (std::filesystem::path(out).extension() == Constants::QR_CODE_EXT) {
+                std::cerr << "PBM pages cannot hold " << levels << " grey levels" << std::endl;
+                return false;
+            }
+
+            int width, height;
+            std::vector<uint8_t> page = buildLevelPage(data, levels, width, height);
+
+            // Four levels fit a bit depth 2 PNG exactly, eight use 8-bit samples
+            const int bitDepth = levels == 4 ? 2 : 8;
+            const size_t stride = (static_cast<size_t>(width) * bitDepth + 7) / 8;
+            std::vector<uint8_t> packed(stride * height, 0);
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    uint8_t level = page[static_cast<size_t>(y) * width + x];
+                    if (bitDepth == 8) {
+                        packed[y * stride + x] = greyForLevel(level, levels);
+                    } else {
+                        packed[y * stride + x * bitDepth / 8] |=
+                                (levels - 1 - level) << (8 - bitDepth - (x * bitDepth) % 8);
+                    }
+                }
+            }
+
+            return PNGUtils::writeGreyscalePNG(out, packed, width, height, bitDepth);
+        }
+
         std::vector<std::vector<bool>> encodedData;
         for (uint8_t byte : data) {
             encodedData.push_back(HammingCode::encodeByte(byte));
@@ -36,65 +208,322 @@ namespace PhysicalStorage {
         uint64_t dataSize = data.size();
         uint64_t bits_size = encodedData[0].size();
 
-        std::vector<uint8_t> imageData;
+        // One byte per module, 1 = black (set bit)
+        std::vector<uint8_t> modules;
 
         // Write data to image
         for (uint64_t i = 0; i < dataSize; i++) {
             std::vector<bool> bits = encodedData[i];
             for (int j = 0; j < bits.size(); j++) {
-                imageData.push_back(bits[j] ? 0 : 255);
+                modules.push_back(bits[j] ? 1 : 0);
             }
         }
 
-        // Write image to file
-        int result = stbi_write_png(out.c_str(), bits_size, dataSize, 1, imageData.data(), bits_size);
+        if (std::filesystem::path(out).extension() == Constants::QR_CODE_EXT) {
+            return PBMUtils::writePBMFile(out, modules, bits_size, dataSize);
+        }
 
-        return result != 0;
+        // Write a bit depth 1 PNG
+        size_t stride = (bits_size + 7) / 8;
+        std::vector<uint8_t> packed(stride * dataSize);
+        for (uint64_t y = 0; y < dataSize; y++) {
+            PBMUtils::packRow(modules.data() + y * bits_size, packed.data() + y * stride, bits_size);
+        }
+
+        return PNGUtils::writeBilevelPNG(out, packed, bits_size, dataSize);
     }
 
-    // Reads a QR code from a file and decodes it
+    // Reads a QR code from a file and writes the decoded data to a file
     bool QRCodeStorage::QRToFile(const std::string &in, const std::string &out) {
+        std::vector<uint8_t> data = QRToBytes(in);
+        if (data.empty()) {
+            return false;
+        }
+
+        // Write data to file
+        std::ofstream outFile(out, std::ios::binary);
+        if (!outFile) {
+            std::cerr << "Cannot open file: " << out << std::endl;
+            return false;
+        }
+
+        outFile.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        return static_cast<bool>(outFile);
+    }
+
+    // Reads a QR code from a file and decodes it
+    std::vector<uint8_t> QRCodeStorage::QRToBytes(const std::string &in) {
         std::ifstream file(in);
         if (!file) {
             std::cerr << "Cannot open QR code file: " << in << std::endl;
             return {};
         }
 
-        // use stb_image to read the image
-        int width, height, channels;
-        uint8_t *imageData = stbi_load(in.c_str(), &width, &height, &channels, 0);
+        // One byte per module: 1 = black (set bit) on two-level pages, grey value on
+        // multi-level ones
+        int width, height;
+        std::vector<uint8_t> modules;
+        bool multiLevel = false;
 
-        if (!imageData) {
+        if (std::filesystem::path(in).extension() == Constants::QR_CODE_EXT) {
+            modules = PBMUtils::parsePBMFile(in, width, height);
+        } else {
+            // use stb_image to read the image
+            int channels;
+            uint8_t *imageData = stbi_load(in.c_str(), &width, &height, &channels, 1);
+
+            if (imageData) {
+                const size_t pixels = static_cast<size_t>(width) * height;
+                std::vector<int> pageWidths;
+                for (int levels = 2; levels <= Constants::MAX_MODULE_LEVELS; levels *= 2) {
+                    pageWidths.push_back(CODEWORD_BITS / bitsPerModule(levels));
+                }
+
+                bool twoLevelPixels = std::all_of(imageData, imageData + pixels, [](uint8_t v) {
+                    return v == 0 || v == 255;
+                });
+
+                if (width == CODEWORD_BITS && twoLevelPixels) {
+                    modules.resize(pixels);
+                    for (size_t i = 0; i < pixels; i++) {
+                        modules[i] = imageData[i] == 0;
+                    }
+                } else if (width != CODEWORD_BITS &&
+                           std::find(pageWidths.begin(), pageWidths.end(), width) != pageWidths.end()) {
+                    modules.assign(imageData, imageData + pixels);
+                    multiLevel = true;
+                } else {
+                    // Scanned page: binarise and sample the module centres
+                    ModuleGrid grid = ScanIngest::sampleModules(imageData, width, height, pageWidths);
+                    std::cout << "Scanned page: " << grid.width << "x" << grid.height << " modules, pitch "
+                            << grid.pitchX << "x" << grid.pitchY << " px" << std::endl;
+                    multiLevel = grid.width != CODEWORD_BITS;
+                    modules = std::move(multiLevel ? grid.grey : grid.modules);
+                    width = grid.width;
+                    height = grid.height;
+                }
+                stbi_image_free(imageData);
+            }
+        }
+
+        if (modules.empty() || modules.size() != static_cast<size_t>(width) * height) {
             std::cerr << "Failed to read image data" << std::endl;
             return {};
         }
 
         std::vector<uint8_t> data;
 
-        // Read image data
-        for (int y = 0; y < height; y++) {
-            std::vector<bool> bits;
-            for (int x = 0; x < width; x++) {
-                bits.push_back(imageData[y * width + x] == 0);
+        if (multiLevel) {
+            if (!readLevelPage(modules, width, height, data)) {
+                return {};
             }
+        } else {
+            // Read image data
+            for (int y = 0; y < height; y++) {
+                std::vector<bool> bits;
+                for (int x = 0; x < width; x++) {
+                    bits.push_back(modules[y * width + x] != 0);
+                }
 
-            uint8_t byte = HammingCode::decodeByte(bits);
-            std::cout << "Decoded byte: " << std::bitset<8>(byte) << std::endl;
-            data.push_back(byte);
+                uint8_t byte = HammingCode::decodeByte(bits);
+                std::cout << "Decoded byte: " << std::bitset<8>(byte) << std::endl;
+                data.push_back(byte);
+            }
         }
 
-        // Write data to file
-        std::ofstream outFile(out, std::ios::binary);
-        if (!outFile) {
-            std::cerr << "Cannot open file: " << out << std::endl;
+        return data;
+    }
+
+    // Splits a file into segments and writes each one as a QR code page
+    bool QRCodeStorage::fileToQRPages(const std::string &in, const std::string &outDir) {
+        return bytesToQRPages(FileManagementHelper::ReadBuffer(in), outDir);
+    }
+
+    // Splits binary data into segments and writes each one as a QR code page
+    bool QRCodeStorage::bytesToQRPages(const std::vector<uint8_t> &data, const std::string &outDir) {
+        if (data.empty()) {
+            std::cerr << "Cannot create QR pages: Empty data" << std::endl;
             return false;
         }
 
-        for (uint8_t byte : data) {
-            outFile.write(reinterpret_cast<const char *>(&byte), sizeof(byte));
+        if (!Utils::ensureDirectoryExists(outDir)) {
+            std::cerr << "Cannot create directory: " << outDir << std::endl;
+            return false;
+        }
+
+        const size_t payloadSize = Constants::QR_PAGE_PAYLOAD_SIZE;
+        const size_t totalPages = (data.size() + payloadSize - 1) / payloadSize;
+
+        for (size_t page = 0; page < totalPages; page++) {
+            // Segment header: magic, sequence number, total number of segments
+            std::vector<uint8_t> segment = FileManagementHelper::StringToBytes(Constants::QR_PAGE_MAGIC);
+            std::vector<uint8_t> seqBytes = FileManagementHelper::IntToBytes(static_cast<int64_t>(page), 4);
+            std::vector<uint8_t> totalBytes = FileManagementHelper::IntToBytes(static_cast<int64_t>(totalPages), 4);
+            segment.insert(segment.end(), seqBytes.begin(), seqBytes.end());
+            segment.insert(segment.end(), totalBytes.begin(), totalBytes.end());
+
+            size_t begin = page * payloadSize;
+            size_t end = std::min(begin + payloadSize, data.size());
+            segment.insert(segment.end(), data.begin() + begin, data.begin() + end);
+
+            QRcode *qr = QRcode_encodeData(static_cast<int>(segment.size()), segment.data(), 0, QR_ECLEVEL_M);
+            if (!qr) {
+                std::cerr << "Failed to encode QR page " << page << std::endl;
+                return false;
+            }
+
+            // Rasterise the modules with a quiet zone around the symbol (1 = black)
+            const int scale = Constants::QR_PAGE_MODULE_PIXELS;
+            const int side = (qr->width + 2 * Constants::QR_PAGE_QUIET_ZONE) * scale;
+            const size_t stride = (side + 7) / 8;
+            std::vector<uint8_t> row(side);
+            std::vector<uint8_t> packed(stride * side, 0);
+
+            for (int y = 0; y < qr->width; y++) {
+                std::fill(row.begin(), row.end(), 0);
+                for (int x = 0; x < qr->width; x++) {
+                    if (qr->data[y * qr->width + x] & 1) {
+                        std::fill_n(row.begin() + (x + Constants::QR_PAGE_QUIET_ZONE) * scale, scale, 1);
+                    }
+                }
+
+                int py = (y + Constants::QR_PAGE_QUIET_ZONE) * scale;
+                for (int dy = 0; dy < scale; dy++) {
+                    PBMUtils::packRow(row.data(), packed.data() + (py + dy) * stride, side);
+                }
+            }
+            QRcode_free(qr);
+
+            std::string pagePath = (std::filesystem::path(outDir) /
+                                    ("page_" + std::to_string(page) + Constants::QR_PAGE_EXT)).string();
+            if (!PNGUtils::writeBilevelPNG(pagePath, packed, side, side)) {
+                std::cerr << "Failed to write QR page: " << pagePath << std::endl;
+                return false;
+            }
+        }
+
+        std::cout << "Wrote " << totalPages << " QR page(s) to " << outDir << std::endl;
+        return true;
+    }
+
+    // Scans a directory of QR code pages and rebuilds the file in memory
+    std::vector<uint8_t> QRCodeStorage::QRPagesToBytes(const std::string &inDir, unsigned int threads) {
+        if (!std::filesystem::is_directory(inDir)) {
+            std::cerr << "Not a directory: " << inDir << std::endl;
+            return {};
+        }
+
+        std::vector<std::string> pages;
+        for (const auto &entry : std::filesystem::directory_iterator(inDir)) {
+            if (entry.is_regular_file()) {
+                pages.push_back(entry.path().string());
+            }
+        }
+
+        if (pages.empty()) {
+            std::cerr << "No QR pages found in: " << inDir << std::endl;
+            return {};
+        }
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min<unsigned int>(threads, pages.size());
+
+        std::map<uint32_t, std::vector<uint8_t>> segments;
+        std::mutex segmentsMutex;
+        std::atomic<size_t> nextPage{0};
+        std::atomic<int64_t> expectedTotal{-1};
+        std::atomic<bool> failed{false};
+
+        auto worker = [&]() {
+            // One scanner per thread: zbar scanners are not thread-safe
+            zbar::ImageScanner scanner;
+            scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 0);
+            scanner.set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_ENABLE, 1);
+            scanner.set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_BINARY, 1);
+
+            for (size_t index = nextPage++; index < pages.size() && !failed.load(); index = nextPage++) {
+                const std::string &path = pages[index];
+
+                int width, height, channels;
+                uint8_t *imageData = stbi_load(path.c_str(), &width, &height, &channels, 1);
+                if (!imageData) {
+                    // Not an image (e.g. a stray file in the directory)
+                    continue;
+                }
+
+                zbar::Image image(width, height, "Y800", imageData, static_cast<unsigned long>(width) * height);
+                scanner.scan(image);
+
+                for (auto symbol = image.symbol_begin(); symbol != image.symbol_end(); ++symbol) {
+                    std::vector<uint8_t> segment = FileManagementHelper::StringToBytes(symbol->get_data());
+                    if (segment.size() < Constants::QR_PAGE_HEADER_SIZE ||
+                        FileManagementHelper::BytesToString({segment.begin(), segment.begin() + 4}) !=
+                        Constants::QR_PAGE_MAGIC) {
+                        continue;
+                    }
+
+                    auto seq = static_cast<uint32_t>(
+                        FileManagementHelper::BytesToInt({segment.begin() + 4, segment.begin() + 8}, 4));
+                    int64_t total = FileManagementHelper::BytesToInt({segment.begin() + 8, segment.begin() + 12}, 4);
+
+                    int64_t expected = -1;
+                    if (!expectedTotal.compare_exchange_strong(expected, total) && expected != total) {
+                        std::cerr << "Inconsistent segment count in " << path << ": " << total
+                                << " instead of " << expected << std::endl;
+                        failed.store(true);
+                        break;
+                    }
+
+                    std::lock_guard<std::mutex> lock(segmentsMutex);
+                    segments.emplace(seq, std::vector<uint8_t>(segment.begin() + Constants::QR_PAGE_HEADER_SIZE,
+                                                               segment.end()));
+                }
+
+                stbi_image_free(imageData);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.emplace_back(worker);
+        }
+        for (auto &t : workers) {
+            t.join();
+        }
+
+        if (failed.load()) {
+            return {};
+        }
+
+        // Every sequence number must be present exactly once
+        int64_t total = expectedTotal.load();
+        if (total <= 0 || segments.size() != static_cast<size_t>(total) ||
+            segments.rbegin()->first != static_cast<uint32_t>(total - 1)) {
+            std::cerr << "Missing QR segments: found " << segments.size() << " of "
+                    << std::max<int64_t>(total, 0) << std::endl;
+            return {};
+        }
+
+        std::vector<uint8_t> data;
+        data.reserve(static_cast<size_t>(total) * Constants::QR_PAGE_PAYLOAD_SIZE);
+        for (const auto &[seq, payload] : segments) {
+            data.insert(data.end(), payload.begin(), payload.end());
+        }
+
+        return data;
+    }
+
+    // Scans a directory of QR code pages and writes the rebuilt file
+    bool QRCodeStorage::QRPagesToFile(const std::string &inDir, const std::string &out) {
+        std::vector<uint8_t> data = QRPagesToBytes(inDir);
+        if (data.empty()) {
+            return false;
         }
 
+        FileManagementHelper::WriteBuffer(out, data);
         return true;
     }
 
-} // namespace PhysicalStorage
\ No newline at end of file
+} // namespace PhysicalStorage
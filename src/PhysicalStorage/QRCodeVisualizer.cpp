@@ -1,7 +1,51 @@
 #include "PhysicalStorage/QRCodeVisualizer.hpp"
 #include "PhysicalStorage/PBMUtils.h"
+#include "PhysicalStorage/PNGUtils.h"
+#include "PhysicalStorage/stb_image_write.h"
+#include <algorithm>
+#include <cctype>
 
 namespace PhysicalStorage {
+    namespace {
+        // Expands packed rows (1 = black) into one greyscale byte per pixel, as textures and stb expect
+        std::vector<uint8_t> packedToGrey(const std::vector<uint8_t> &packed, size_t width, size_t height) {
+            const size_t stride = (width + 7) / 8;
+            std::vector<uint8_t> grey(width * height);
+
+            for (size_t y = 0; y < height; y++) {
+                uint8_t *row = grey.data() + y * width;
+                PBMUtils::unpackRow(packed.data() + y * stride, row, width);
+                for (size_t x = 0; x < width; x++) {
+                    row[x] = row[x] ? 0 : 255;
+                }
+            }
+
+            return grey;
+        }
+
+        // Shows a bit matrix as a single texture stretched over the window until it is closed
+        void showPackedMatrix(const std::vector<uint8_t> &packed, size_t width, size_t height, int screenWidth,
+                              int screenHeight) {
+            std::vector<uint8_t> pixels = packedToGrey(packed, width, height);
+            Image image{pixels.data(), static_cast<int>(width), static_cast<int>(height), 1,
+                        PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+            Texture2D texture = LoadTextureFromImage(image);
+            SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+
+            const Rectangle source{0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)};
+            const Rectangle dest{0.0f, 0.0f, static_cast<float>(screenWidth), static_cast<float>(screenHeight)};
+
+            while (!WindowShouldClose()) {
+                BeginDrawing();
+                ClearBackground(RAYWHITE);
+                DrawTexturePro(texture, source, dest, Vector2{0.0f, 0.0f}, 0.0f, WHITE);
+                EndDrawing();
+            }
+
+            UnloadTexture(texture);
+        }
+    }
+
     // Implementation of QRCodeVisualizer class methods
     void QRCodeVisualizer::displayQRCode(const std::string &filename, const std::string &windowTitle, int width,
                                          int height) {
@@ -11,45 +55,105 @@ namespace PhysicalStorage {
         // Read the PBM file
         int qrWidth = 0;
         int qrHeight = 0;
-        std::vector<uint8_t> qrData = PBMUtils::parsePBMFile(filename, qrWidth, qrHeight);
+        std::vector<uint8_t> qrData = PBMUtils::parsePBMFilePacked(filename, qrWidth, qrHeight);
 
         if (qrData.empty() || qrWidth == 0 || qrHeight == 0) {
             CloseWindow();
             return;
         }
 
-        // Render the QR code until window is closed
-        while (!WindowShouldClose()) {
-            BeginDrawing();
-            ClearBackground(RAYWHITE);
-
-            // Calculate cell size based on window dimensions and QR code size
-            float cellWidth = static_cast<float>(width) / qrWidth;
-            float cellHeight = static_cast<float>(height) / qrHeight;
-
-            // Draw each QR code cell
-            for (int y = 0; y < qrHeight; y++) {
-                for (int x = 0; x < qrWidth; x++) {
-                    int index = y * qrWidth + x;
-                    if (index < static_cast<int>(qrData.size()) && qrData[index] == 1) {
-                        DrawRectangle(
-                            static_cast<int>(x * cellWidth),
-                            static_cast<int>(y * cellHeight),
-                            static_cast<int>(cellWidth + 1),
-                            static_cast<int>(cellHeight + 1),
-                            BLACK
-                        );
-                    }
-                }
-            }
+        showPackedMatrix(qrData, qrWidth, qrHeight, width, height);
+        CloseWindow();
+    }
 
-            EndDrawing();
+    void QRCodeVisualizer::displayBitMatrix(const std::vector<uint8_t> &data, size_t width, size_t height,
+                                            const std::string &windowTitle, int screenWidth, int screenHeight) {
+        if (width == 0 || height == 0 || data.size() < (width + 7) / 8 * height) {
+            std::cerr << "Invalid bit matrix: " << width << "x" << height << " from " << data.size() << " bytes"
+                      << std::endl;
+            return;
         }
 
+        InitWindow(screenWidth, screenHeight, windowTitle.c_str());
+        SetTargetFPS(60);
+
+        showPackedMatrix(data, width, height, screenWidth, screenHeight);
         CloseWindow();
     }
 
-    // Implementation of other methods would go here
+    bool QRCodeVisualizer::saveBitMatrixImage(const std::vector<uint8_t> &data, size_t width, size_t height,
+                                              const std::string &outputFilename, int imageWidth, int imageHeight) {
+        const size_t stride = (width + 7) / 8;
+        if (width == 0 || height == 0 || data.size() < stride * height) {
+            std::cerr << "Invalid bit matrix: " << width << "x" << height << " from " << data.size() << " bytes"
+                      << std::endl;
+            return false;
+        }
+        if (imageWidth <= 0 || imageHeight <= 0) {
+            std::cerr << "Invalid image dimensions: " << imageWidth << "x" << imageHeight << std::endl;
+            return false;
+        }
+
+        // Nearest-neighbour scaling, one source column lookup per output column
+        std::vector<size_t> sourceColumn(imageWidth);
+        for (int x = 0; x < imageWidth; x++) {
+            sourceColumn[x] = static_cast<size_t>(x) * width / imageWidth;
+        }
+
+        const size_t outStride = (static_cast<size_t>(imageWidth) + 7) / 8;
+        std::vector<uint8_t> scaled(outStride * imageHeight);
+        std::vector<uint8_t> sourceRow(width);
+        std::vector<uint8_t> outRow(imageWidth);
+        size_t lastSource = height;
+
+        for (int y = 0; y < imageHeight; y++) {
+            const size_t source = static_cast<size_t>(y) * height / imageHeight;
+            uint8_t *out = scaled.data() + y * outStride;
 
+            // Upscaled rows repeat: copy the packed row instead of rebuilding it
+            if (source == lastSource) {
+                std::copy(out - outStride, out, out);
+                continue;
+            }
 
+            PBMUtils::unpackRow(data.data() + source * stride, sourceRow.data(), width);
+            for (int x = 0; x < imageWidth; x++) {
+                outRow[x] = sourceRow[sourceColumn[x]];
+            }
+            PBMUtils::packRow(outRow.data(), out, imageWidth);
+            lastSource = source;
+        }
+
+        std::string extension = std::filesystem::path(outputFilename).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+        // PNG and PBM take the packed rows as they are
+        if (extension == ".png") {
+            return PNGUtils::writeBilevelPNG(outputFilename, scaled, imageWidth, imageHeight);
+        }
+        if (extension == ".pbm") {
+            return PBMUtils::writePBMFilePacked(outputFilename, scaled, imageWidth, imageHeight);
+        }
+
+        // Other formats go through stb, which only takes whole bytes
+        std::vector<uint8_t> grey = packedToGrey(scaled, imageWidth, imageHeight);
+        int written = 0;
+        if (extension == ".bmp") {
+            written = stbi_write_bmp(outputFilename.c_str(), imageWidth, imageHeight, 1, grey.data());
+        } else if (extension == ".tga") {
+            written = stbi_write_tga(outputFilename.c_str(), imageWidth, imageHeight, 1, grey.data());
+        } else if (extension == ".jpg" || extension == ".jpeg") {
+            written = stbi_write_jpg(outputFilename.c_str(), imageWidth, imageHeight, 1, grey.data(), 95);
+        } else {
+            std::cerr << "Unsupported image format: " << outputFilename << std::endl;
+            return false;
+        }
+
+        if (!written) {
+            std::cerr << "Failed to write image: " << outputFilename << std::endl;
+            return false;
+        }
+        return true;
+    }
 } // namespace PhysicalStorage
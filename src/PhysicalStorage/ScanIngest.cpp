@@ -0,0 +1,454 @@
+#include "PhysicalStorage/ScanIngest.h"
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace PhysicalStorage {
+    namespace {
+        // Adds (sign > 0) or subtracts a pixel row from the running column sums
+        void accumulateRow(uint32_t *colSum, const uint8_t *row, int width, int sign) {
+            int x = 0;
+
+#if defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 16 <= width; x += 16) {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+                __m128i halves[2] = {_mm_unpacklo_epi8(pixels, zero), _mm_unpackhi_epi8(pixels, zero)};
+
+                for (int h = 0; h < 2; h++) {
+                    __m128i words[2] = {_mm_unpacklo_epi16(halves[h], zero), _mm_unpackhi_epi16(halves[h], zero)};
+                    for (int w = 0; w < 2; w++) {
+                        auto *dst = reinterpret_cast<__m128i *>(colSum + x + h * 8 + w * 4);
+                        __m128i sums = _mm_loadu_si128(dst);
+                        sums = sign > 0 ? _mm_add_epi32(sums, words[w]) : _mm_sub_epi32(sums, words[w]);
+                        _mm_storeu_si128(dst, sums);
+                    }
+                }
+            }
+#endif
+
+            for (; x < width; x++) {
+                colSum[x] += sign > 0 ? row[x] : -static_cast<uint32_t>(row[x]);
+            }
+        }
+
+        // Global threshold between the dark and light modes (Otsu's method)
+        int otsuThreshold(const uint8_t *grey, size_t count) {
+            std::array<uint64_t, 256> histogram{};
+            for (size_t i = 0; i < count; i++) {
+                histogram[grey[i]]++;
+            }
+
+            double total = 0.0;
+            for (int i = 0; i < 256; i++) total += static_cast<double>(i) * histogram[i];
+
+            double sumBelow = 0.0, bestVariance = -1.0;
+            uint64_t countBelow = 0;
+            int best = 128;
+            for (int t = 0; t < 256; t++) {
+                countBelow += histogram[t];
+                if (countBelow == 0 || countBelow == count) continue;
+
+                sumBelow += static_cast<double>(t) * histogram[t];
+                double meanBelow = sumBelow / countBelow;
+                double meanAbove = (total - sumBelow) / (count - countBelow);
+                double variance = static_cast<double>(countBelow) * (count - countBelow) *
+                                  (meanBelow - meanAbove) * (meanBelow - meanAbove);
+                if (variance > bestVariance) {
+                    bestVariance = variance;
+                    best = t + 1;
+                }
+            }
+            return best;
+        }
+
+        // Sum of absolute grey differences across each column boundary (between x - 1
+        // and x) over rows [y0, y1]; module edges show up as periodic peaks
+        std::vector<double> columnEdges(const uint8_t *grey, int width, int y0, int y1) {
+            std::vector<uint32_t> sums(width + 1, 0);
+            for (int y = y0; y <= y1; y++) {
+                const uint8_t *row = grey + static_cast<size_t>(y) * width;
+                for (int x = 1; x < width; x++) {
+                    sums[x] += std::abs(row[x] - row[x - 1]);
+                }
+            }
+            return {sums.begin(), sums.end()};
+        }
+
+        // Same across each row boundary (between y - 1 and y) over columns [x0, x1]
+        std::vector<double> rowEdges(const uint8_t *grey, int width, int height, int x0, int x1) {
+            std::vector<double> edges(height + 1, 0.0);
+            for (int y = 1; y < height; y++) {
+                const uint8_t *above = grey + static_cast<size_t>(y - 1) * width;
+                const uint8_t *row = grey + static_cast<size_t>(y) * width;
+                uint32_t sum = 0;
+                for (int x = x0; x <= x1; x++) {
+                    sum += std::abs(row[x] - above[x]);
+                }
+                edges[y] = sum;
+            }
+            return edges;
+        }
+
+        // Parabolic refinement of a local maximum
+        double refinePeak(const std::vector<double> &values, size_t index) {
+            if (index == 0 || index + 1 >= values.size()) return static_cast<double>(index);
+            double denominator = values[index - 1] - 2 * values[index] + values[index + 1];
+            if (denominator >= 0.0) return static_cast<double>(index);
+            return index + 0.5 * (values[index - 1] - values[index + 1]) / denominator;
+        }
+
+        // Module pitch from the autocorrelation of an edge profile over [begin, end):
+        // the first strong peak gives a coarse pitch, later peaks refine it
+        double pitchFromProfile(const std::vector<double> &edges, int begin, int end) {
+            const int n = end - begin;
+            if (n < 8) return 0.0;
+
+            double mean = 0.0;
+            for (int i = begin; i < end; i++) mean += edges[i];
+            mean /= n;
+
+            std::vector<double> profile(n);
+            for (int i = 0; i < n; i++) profile[i] = edges[begin + i] - mean;
+
+            const int maxLag = n / 2;
+            std::vector<double> correlation(maxLag + 2, 0.0);
+            for (int lag = 1; lag <= maxLag + 1 && lag < n; lag++) {
+                double sum = 0.0;
+                for (int i = 0; i + lag < n; i++) sum += profile[i] * profile[i + lag];
+                correlation[lag] = sum / (n - lag);
+            }
+
+            double best = 0.0;
+            for (int lag = 2; lag <= maxLag; lag++) best = std::max(best, correlation[lag]);
+            if (best <= 0.0) return 0.0;
+
+            auto isPeak = [&](int lag) {
+                return correlation[lag] >= 0.5 * best &&
+                       correlation[lag] >= correlation[lag - 1] && correlation[lag] >= correlation[lag + 1];
+            };
+
+            int first = 2;
+            while (first <= maxLag && !isPeak(first)) first++;
+            if (first > maxLag) return 0.0;
+
+            double pitch = refinePeak(correlation, first);
+            for (int multiple = 2; multiple * pitch + pitch / 4 < maxLag; multiple++) {
+                int centre = static_cast<int>(std::lround(multiple * pitch));
+                int radius = std::max(1, static_cast<int>(pitch / 4));
+                int peak = centre;
+                for (int lag = centre - radius; lag <= centre + radius; lag++) {
+                    if (correlation[lag] > correlation[peak]) peak = lag;
+                }
+                if (isPeak(peak)) {
+                    pitch = refinePeak(correlation, peak) / multiple;
+                }
+            }
+            return pitch;
+        }
+
+        // Edge strength at a fractional position, smoothed over neighbouring boundaries
+        // so edges blurred across two pixels still peak where they belong
+        double edgeAt(const std::vector<double> &edges, double position) {
+            auto smoothed = [&](int i) {
+                if (i < 1 || i + 1 >= static_cast<int>(edges.size())) return 0.0;
+                return 0.25 * edges[i - 1] + 0.5 * edges[i] + 0.25 * edges[i + 1];
+            };
+            int i = static_cast<int>(std::floor(position));
+            double t = position - i;
+            return (1.0 - t) * smoothed(i) + t * smoothed(i + 1);
+        }
+
+        // Moves the outer edges of `modules` columns within `radius` of their estimates
+        // so that the module boundaries between them line up best with the edge profile
+        void fitColumns(const std::vector<double> &edges, int modules, double radius, double &left, double &right) {
+            const double step = 0.25;
+            const double initialLeft = left, initialRight = right;
+            double bestScore = -1.0;
+
+            for (double l = initialLeft - radius; l <= initialLeft + radius; l += step) {
+                for (double r = initialRight - radius; r <= initialRight + radius; r += step) {
+                    double pitch = (r - l) / modules;
+                    if (pitch <= 1.0) continue;
+
+                    double score = 0.0;
+                    for (int k = 0; k <= modules; k++) score += edgeAt(edges, l + k * pitch);
+                    if (score > bestScore) {
+                        bestScore = score;
+                        left = l;
+                        right = r;
+                    }
+                }
+            }
+        }
+
+        // Position of the strongest edge in [from, to], refined to a fraction of a
+        // pixel since blur spreads an edge over neighbouring boundaries
+        double strongestEdge(const std::vector<double> &edges, double from, double to, double &strength) {
+            int first = std::max(2, static_cast<int>(std::floor(from)));
+            int last = std::min(static_cast<int>(edges.size()) - 2, static_cast<int>(std::ceil(to)));
+            int best = first;
+            for (int i = first; i <= last; i++) {
+                if (edgeAt(edges, i) > edgeAt(edges, best)) best = i;
+            }
+
+            strength = edgeAt(edges, best);
+            double before = edgeAt(edges, best - 1), after = edgeAt(edges, best + 1);
+            double curvature = before - 2 * strength + after;
+            return curvature < 0.0 ? best + 0.5 * (before - after) / curvature : best;
+        }
+
+        double strongestEdge(const std::vector<double> &edges, double from, double to) {
+            double strength;
+            return strongestEdge(edges, from, to, strength);
+        }
+    }
+
+    std::vector<uint8_t> ScanIngest::binarize(const uint8_t *grey, int width, int height, int window,
+                                              float sensitivity) {
+        if (!grey || width <= 0 || height <= 0) {
+            return {};
+        }
+
+        if (window <= 0) {
+            window = std::clamp(std::max(width, height) / 8, 15, 255);
+        }
+        const int radius = window / 2;
+
+        // Large uniformly dark areas have a dark local mean, so a global floor keeps them dark
+        const float floorThreshold = otsuThreshold(grey, static_cast<size_t>(width) * height) * (1.0f - sensitivity);
+
+        std::vector<uint8_t> binary(static_cast<size_t>(width) * height);
+        std::vector<uint32_t> colSum(width, 0);
+        std::vector<uint32_t> rowSum(width);
+        std::vector<float> inverseCount(width);
+
+        for (int x = 0; x < width; x++) {
+            int x0 = std::max(0, x - radius), x1 = std::min(width - 1, x + radius);
+            inverseCount[x] = 1.0f / (x1 - x0 + 1);
+        }
+
+        for (int y = 0; y < std::min(radius, height); y++) {
+            accumulateRow(colSum.data(), grey + static_cast<size_t>(y) * width, width, 1);
+        }
+
+        for (int y = 0; y < height; y++) {
+            // Slide the vertical window to rows [y - radius, y + radius]
+            if (y + radius < height) {
+                accumulateRow(colSum.data(), grey + static_cast<size_t>(y + radius) * width, width, 1);
+            }
+            if (y - radius - 1 >= 0) {
+                accumulateRow(colSum.data(), grey + static_cast<size_t>(y - radius - 1) * width, width, -1);
+            }
+            const int rows = std::min(height - 1, y + radius) - std::max(0, y - radius) + 1;
+            const float scale = (1.0f - sensitivity) / rows;
+
+            // Horizontal box sums of the column sums
+            uint32_t running = 0;
+            for (int x = 0; x < std::min(radius, width); x++) running += colSum[x];
+            for (int x = 0; x < width; x++) {
+                if (x + radius < width) running += colSum[x + radius];
+                if (x - radius - 1 >= 0) running -= colSum[x - radius - 1];
+                rowSum[x] = running;
+            }
+
+            const uint8_t *src = grey + static_cast<size_t>(y) * width;
+            uint8_t *dst = binary.data() + static_cast<size_t>(y) * width;
+            int x = 0;
+
+#if defined(__SSE2__)
+            const __m128 scaleVec = _mm_set1_ps(scale);
+            const __m128 floorVec = _mm_set1_ps(floorThreshold);
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i one = _mm_set1_epi8(1);
+
+            for (; x + 16 <= width; x += 16) {
+                __m128i parts[4];
+                for (int p = 0; p < 4; p++) {
+                    __m128 sums = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&rowSum[x + p * 4])));
+                    __m128 local = _mm_mul_ps(_mm_mul_ps(sums, scaleVec), _mm_loadu_ps(&inverseCount[x + p * 4]));
+                    parts[p] = _mm_cvttps_epi32(_mm_max_ps(local, floorVec));
+                }
+                __m128i thresholds = _mm_packus_epi16(_mm_packs_epi32(parts[0], parts[1]),
+                                                      _mm_packs_epi32(parts[2], parts[3]));
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+
+                // pixel < threshold  <=>  saturating (threshold - pixel) != 0
+                __m128i light = _mm_cmpeq_epi8(_mm_subs_epu8(thresholds, pixels), zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_andnot_si128(light, one));
+            }
+#endif
+
+            for (; x < width; x++) {
+                float local = std::max(rowSum[x] * scale * inverseCount[x], floorThreshold);
+                dst[x] = src[x] < static_cast<uint8_t>(std::min(255.0f, local));
+            }
+        }
+
+        return binary;
+    }
+
+    bool ScanIngest::estimatePitch(const uint8_t *grey, int width, int height, double &pitchX, double &pitchY) {
+        pitchX = pitchFromProfile(columnEdges(grey, width, 0, height - 1), 1, width);
+        pitchY = pitchFromProfile(rowEdges(grey, width, height, 0, width - 1), 1, height);
+
+        // A page with a single module along one axis has the same pitch as the other
+        if (pitchX <= 0.0) pitchX = pitchY;
+        if (pitchY <= 0.0) pitchY = pitchX;
+        return pitchX > 0.0;
+    }
+
+    ModuleGrid ScanIngest::sampleModules(const uint8_t *grey, int width, int height,
+                                         const std::vector<int> &allowedWidths) {
+        ModuleGrid grid;
+
+        std::vector<uint8_t> binary = binarize(grey, width, height);
+        if (binary.empty()) {
+            return grid;
+        }
+
+        std::vector<uint32_t> darkPerRow(height, 0), darkPerColumn(width, 0);
+        for (int y = 0; y < height; y++) {
+            const uint8_t *row = binary.data() + static_cast<size_t>(y) * width;
+            for (int x = 0; x < width; x++) {
+                darkPerRow[y] += row[x];
+                darkPerColumn[x] += row[x];
+            }
+        }
+
+        // Bounding box of the rows and columns holding at least `limit` dark pixels
+        int minX, maxX, minY, maxY;
+        auto darkBox = [&](double rowLimit, double columnLimit) {
+            auto first = [](const std::vector<uint32_t> &counts, double limit, int from, int step) {
+                for (int i = from; i >= 0 && i < static_cast<int>(counts.size()); i += step) {
+                    if (counts[i] >= limit) return i;
+                }
+                return -1;
+            };
+            minY = first(darkPerRow, rowLimit, 0, 1);
+            maxY = first(darkPerRow, rowLimit, height - 1, -1);
+            minX = first(darkPerColumn, columnLimit, 0, 1);
+            maxX = first(darkPerColumn, columnLimit, width - 1, -1);
+            return minX >= 0 && minY >= 0;
+        };
+
+        if (!darkBox(2, 2)) {
+            std::cerr << "No dark modules found in scan" << std::endl;
+            return grid;
+        }
+
+        // Edge profiles of the page area give the pitch along each axis
+        std::vector<double> edgesX = columnEdges(grey, width, minY, maxY);
+        std::vector<double> edgesY = rowEdges(grey, width, height, minX, maxX);
+
+        double pitchX = pitchFromProfile(edgesX, minX, maxX + 2);
+        double pitchY = pitchFromProfile(edgesY, minY, maxY + 2);
+        if (pitchX <= 0.0) pitchX = pitchY;
+        if (pitchY <= 0.0) pitchY = pitchX;
+        if (pitchX <= 0.0) {
+            std::cerr << "Cannot detect the module pitch of the scan" << std::endl;
+            return grid;
+        }
+
+        // Rows and columns need at least half a module of dark pixels, so isolated
+        // specks of noise are ignored; the page edges then snap to the grey edges,
+        // which blur does not shift. Blur only grows the dark box, so the search
+        // reaches further inwards than outwards
+        darkBox(std::max(2.0, pitchX / 2), std::max(2.0, pitchY / 2));
+        double left = strongestEdge(edgesX, minX - pitchX / 4, minX + pitchX / 2);
+        double right = strongestEdge(edgesX, maxX + 1 - pitchX / 2, maxX + 1 + pitchX / 4);
+        const double top = strongestEdge(edgesY, minY - pitchY / 4, minY + pitchY / 2);
+        const double bottom = strongestEdge(edgesY, maxY + 1 - pitchY / 2, maxY + 1 + pitchY / 4);
+        const double boxWidth = std::max(1.0, right - left);
+        const double boxHeight = std::max(1.0, bottom - top);
+
+        // Trust the known page widths, picking the one that agrees best with the pitch
+        if (!allowedWidths.empty()) {
+            int modulesWide = allowedWidths.front();
+            for (int candidate : allowedWidths) {
+                if (std::abs(std::log(boxWidth / candidate / pitchX)) <
+                    std::abs(std::log(boxWidth / modulesWide / pitchX))) {
+                    modulesWide = candidate;
+                }
+            }
+
+            fitColumns(edgesX, modulesWide, pitchX / 2, left, right);
+            double fitted = (right - left) / modulesWide;
+            if (std::abs(fitted - pitchX) > 0.25 * pitchX) {
+                std::cerr << "Scan pitch " << pitchX << " px disagrees with page width, using "
+                        << fitted << " px" << std::endl;
+            }
+            pitchX = fitted;
+            grid.width = modulesWide;
+        } else {
+            grid.width = std::max(1, static_cast<int>(std::lround(boxWidth / pitchX)));
+            fitColumns(edgesX, grid.width, pitchX / 2, left, right);
+            pitchX = (right - left) / grid.width;
+        }
+
+        // Track the row boundaries down the page: each one is expected a pitch below
+        // the previous one and snaps to the strongest nearby edge, so small pitch
+        // errors and scanner drift do not accumulate over tall pages
+        std::vector<double> pageEdges(edgesY.begin() + minY, edgesY.begin() + maxY + 2);
+        std::nth_element(pageEdges.begin(), pageEdges.begin() + pageEdges.size() / 2, pageEdges.end());
+        const double edgeFloor = 2.0 * pageEdges[pageEdges.size() / 2];
+        const int searchRadius = std::max(1, static_cast<int>(pitchY / 3));
+        std::vector<double> rowCentres;
+
+        for (double boundary = top; boundary + pitchY / 2 < bottom;) {
+            double expected = boundary + pitchY;
+            double next = expected;
+
+            double strength;
+            double peak = strongestEdge(edgesY, expected - searchRadius, expected + searchRadius, strength);
+            if (strength > edgeFloor) {
+                next = peak;
+            }
+
+            next = std::min(next, bottom);
+            rowCentres.push_back((boundary + next) / 2);
+            boundary = next;
+        }
+
+        grid.height = static_cast<int>(rowCentres.size());
+        grid.pitchX = pitchX;
+        grid.pitchY = boxHeight / grid.height;
+
+        // Majority vote over a small box around each module centre
+        const int rx = static_cast<int>(pitchX / 4);
+        const int ry = static_cast<int>(grid.pitchY / 4);
+        grid.modules.resize(static_cast<size_t>(grid.width) * grid.height);
+        grid.grey.resize(grid.modules.size());
+
+        for (int my = 0; my < grid.height; my++) {
+            int cy = static_cast<int>(rowCentres[my]);
+            int y0 = std::max(0, cy - ry), y1 = std::min(height - 1, cy + ry);
+
+            for (int mx = 0; mx < grid.width; mx++) {
+                int cx = static_cast<int>(left + (mx + 0.5) * pitchX);
+                int x0 = std::max(0, cx - rx), x1 = std::min(width - 1, cx + rx);
+
+                int dark = 0;
+                uint32_t sum = 0;
+                for (int y = y0; y <= y1; y++) {
+                    const uint8_t *row = binary.data() + static_cast<size_t>(y) * width;
+                    const uint8_t *pixels = grey + static_cast<size_t>(y) * width;
+                    for (int x = x0; x <= x1; x++) {
+                        dark += row[x];
+                        sum += pixels[x];
+                    }
+                }
+
+                const int area = (y1 - y0 + 1) * (x1 - x0 + 1);
+                const size_t index = static_cast<size_t>(my) * grid.width + mx;
+                grid.modules[index] = 2 * dark > area;
+                grid.grey[index] = static_cast<uint8_t>(sum / area);
+            }
+        }
+
+        return grid;
+    }
+}
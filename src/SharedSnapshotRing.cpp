@@ -0,0 +1,162 @@
+#include "SharedSnapshotRing.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr uint32_t RING_MAGIC = 0x564e4544; // "DENV"
+    constexpr uint32_t RING_VERSION = 1;
+    constexpr int RING_SLOTS = 4;
+    constexpr int64_t HEARTBEAT_TIMEOUT_NS = 1000000000;
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared atomics must be lock-free");
+
+    int64_t monotonicNow() {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+}
+
+struct SharedRingLayout {
+    struct Slot {
+        std::atomic<uint64_t> sequence;     // Odd while the writer is copying
+        GridSnapshot snapshot;
+    };
+
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<int32_t> writerPid;
+    std::atomic<uint32_t> finished;
+    std::atomic<int64_t> heartbeat;         // CLOCK_MONOTONIC time of the last viewer poll
+    std::atomic<uint64_t> published;        // Snapshots written so far
+    Slot slots[RING_SLOTS];
+};
+
+SharedSnapshotPublisher::SharedSnapshotPublisher(const std::string &name) : m_name(name) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("[e] Error creating shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    if (ftruncate(fd, sizeof(SharedRingLayout)) != 0) {
+        close(fd);
+        throw std::runtime_error("[e] Error sizing shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    void *memory = mmap(nullptr, sizeof(SharedRingLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("[e] Error mapping shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    // Reuse a leftover object in place, so viewers that are still attached keep working
+    m_ring = static_cast<SharedRingLayout *>(memory);
+    m_ring->magic = RING_MAGIC;
+    m_ring->version = RING_VERSION;
+    m_ring->finished.store(0);
+    m_ring->writerPid.store(static_cast<int32_t>(getpid()));
+}
+
+SharedSnapshotPublisher::~SharedSnapshotPublisher() {
+    if (m_ring) {
+        m_ring->finished.store(1);
+        munmap(m_ring, sizeof(SharedRingLayout));
+        shm_unlink(m_name.c_str());
+    }
+}
+
+bool SharedSnapshotPublisher::hasViewers() const {
+    return monotonicNow() - m_ring->heartbeat.load(std::memory_order_relaxed) < HEARTBEAT_TIMEOUT_NS;
+}
+
+void SharedSnapshotPublisher::publish(const GridSnapshot &snapshot) {
+    const uint64_t count = m_ring->published.load(std::memory_order_relaxed);
+    SharedRingLayout::Slot &slot = m_ring->slots[count % RING_SLOTS];
+
+    const uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&slot.snapshot, &snapshot, sizeof(GridSnapshot));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    m_ring->published.store(count + 1, std::memory_order_release);
+}
+
+SharedSnapshotViewer::SharedSnapshotViewer(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw std::runtime_error("[e] Error opening shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedRingLayout)) {
+        close(fd);
+        throw std::runtime_error("[e] Shared memory " + name + " is not a snapshot ring.");
+    }
+
+    void *memory = mmap(nullptr, sizeof(SharedRingLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("[e] Error mapping shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    m_ring = static_cast<SharedRingLayout *>(memory);
+    if (m_ring->magic != RING_MAGIC || m_ring->version != RING_VERSION) {
+        munmap(m_ring, sizeof(SharedRingLayout));
+        m_ring = nullptr;
+        throw std::runtime_error("[e] Shared memory " + name + " is not a snapshot ring.");
+    }
+
+    m_ring->heartbeat.store(monotonicNow(), std::memory_order_relaxed);
+}
+
+SharedSnapshotViewer::~SharedSnapshotViewer() {
+    if (m_ring) {
+        munmap(m_ring, sizeof(SharedRingLayout));
+    }
+}
+
+bool SharedSnapshotViewer::latest(GridSnapshot &snapshot) {
+    m_ring->heartbeat.store(monotonicNow(), std::memory_order_relaxed);
+
+    const uint64_t count = m_ring->published.load(std::memory_order_acquire);
+    if (count == m_lastSeen || count == 0) {
+        return false;
+    }
+
+    // Retry if the writer laps the slot while it is being copied
+    const SharedRingLayout::Slot &slot = m_ring->slots[(count - 1) % RING_SLOTS];
+    for (int attempt = 0; attempt < 8; attempt++) {
+        const uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+
+        std::memcpy(&snapshot, &slot.snapshot, sizeof(GridSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            m_lastSeen = count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool SharedSnapshotViewer::publisherAlive() const {
+    if (m_ring->finished.load()) {
+        return false;
+    }
+
+    pid_t pid = m_ring->writerPid.load();
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
@@ -0,0 +1,41 @@
+#include "SnapshotChannel.h"
+
+void packGrid(const int *cells, PackedGrid &packed) {
+    for (int w = 0; w < GRID_WORDS; w++, cells += 64) {
+        uint64_t word = 0;
+        for (int b = 0; b < 64; b++) {
+            word |= static_cast<uint64_t>(cells[b] & 1) << b;
+        }
+        packed[w] = word;
+    }
+}
+
+void unpackGrid(const PackedGrid &packed, std::array<int, BUFFER_SIZE> &grid) {
+    for (int w = 0; w < GRID_WORDS; w++) {
+        int *cells = grid.data() + w * 64;
+        for (int b = 0; b < 64; b++) {
+            cells[b] = static_cast<int>((packed[w] >> b) & 1);
+        }
+    }
+}
+
+SnapshotChannel::SnapshotChannel()
+    : m_slots(new GridSnapshot[3]()),
+      m_middle(1),
+      m_back(0),
+      m_front(2) {
+}
+
+void SnapshotChannel::publish() {
+    // Release: the consumer must see the slot contents once it sees the index
+    m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+}
+
+bool SnapshotChannel::acquire() {
+    if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) {
+        return false;
+    }
+
+    m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+    return true;
+}
@@ -0,0 +1,35 @@
+#include "SpinBarrier.h"
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPIN_PAUSE() _mm_pause()
+#else
+#define SPIN_PAUSE() ((void) 0)
+#endif
+
+namespace {
+    constexpr int SPINS_BEFORE_YIELD = 1024;
+}
+
+SpinBarrier::SpinBarrier(int participants) : m_participants(participants) {
+}
+
+void SpinBarrier::wait() {
+    const unsigned phase = m_phase.load(std::memory_order_acquire);
+
+    // The last one to arrive resets the count and releases the others
+    if (m_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == m_participants) {
+        m_waiting.store(0, std::memory_order_relaxed);
+        m_phase.store(phase + 1, std::memory_order_release);
+        return;
+    }
+
+    for (int spins = 0; m_phase.load(std::memory_order_acquire) == phase; spins++) {
+        if (spins < SPINS_BEFORE_YIELD) {
+            SPIN_PAUSE();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
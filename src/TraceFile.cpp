@@ -0,0 +1,215 @@
+#include "TraceFile.h"
+#include "FormatManager/FileManagementHelper.hpp"
+#include "PhysicalStorage/PBMUtils.h"
+#include "PhysicalStorage/PNGUtils.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+    const std::string TRACE_MAGIC = "DNST";
+    constexpr int TRACE_VERSION = 1;
+    constexpr size_t GRIDS_BYTES = 2 * GRID_WORDS * sizeof(uint64_t);
+    constexpr size_t FRAME_HEADER_SIZE = 1 + 5 * 4;
+
+    void gridsToBytes(const GridSnapshot &snapshot, uint8_t *bytes) {
+        std::memcpy(bytes, snapshot.currentGrid.data(), GRIDS_BYTES / 2);
+        std::memcpy(bytes + GRIDS_BYTES / 2, snapshot.prevGrid.data(), GRIDS_BYTES / 2);
+    }
+
+    void bytesToGrids(const uint8_t *bytes, GridSnapshot &snapshot) {
+        std::memcpy(snapshot.currentGrid.data(), bytes, GRIDS_BYTES / 2);
+        std::memcpy(snapshot.prevGrid.data(), bytes + GRIDS_BYTES / 2, GRIDS_BYTES / 2);
+    }
+
+    void appendInt(std::vector<uint8_t> &buffer, int64_t value, int size) {
+        std::vector<uint8_t> bytes = FileManagementHelper::IntToBytes(value, size);
+        buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+    }
+}
+
+// The iteration counts give away part of the key, so only the owner may read the trace
+TraceRecorder::TraceRecorder(const std::string &path) : m_file(FileManagementHelper::CreatePrivate(path)) {
+    std::vector<uint8_t> header = FileManagementHelper::StringToBytes(TRACE_MAGIC);
+    appendInt(header, TRACE_VERSION, 1);
+    appendInt(header, SIDE, 2);
+    fwrite(header.data(), 1, header.size(), m_file);
+
+    m_delta.resize(GRIDS_BYTES);
+    m_compressed.resize(compressBound(GRIDS_BYTES));
+}
+
+TraceRecorder::~TraceRecorder() {
+    close();
+}
+
+void TraceRecorder::record(const GridSnapshot &snapshot) {
+    if (!m_file) {
+        return;
+    }
+
+    // Key frames bound how much a damaged frame can corrupt
+    const bool keyFrame = m_frames % KEY_FRAME_INTERVAL == 0;
+    if (keyFrame) {
+        gridsToBytes(snapshot, m_delta.data());
+    } else {
+        auto *delta = reinterpret_cast<uint64_t *>(m_delta.data());
+        for (int w = 0; w < GRID_WORDS; w++) {
+            delta[w] = snapshot.currentGrid[w] ^ m_previous.currentGrid[w];
+            delta[GRID_WORDS + w] = snapshot.prevGrid[w] ^ m_previous.prevGrid[w];
+        }
+    }
+    m_previous = snapshot;
+
+    // Fastest level: recording stays cheap enough to leave on
+    uLongf compressedSize = m_compressed.size();
+    if (compress2(m_compressed.data(), &compressedSize, m_delta.data(), GRIDS_BYTES, Z_BEST_SPEED) != Z_OK) {
+        throw std::runtime_error("[e] Error compressing trace frame.");
+    }
+
+    std::vector<uint8_t> header;
+    header.reserve(FRAME_HEADER_SIZE);
+    appendInt(header, keyFrame ? 1 : 0, 1);
+    appendInt(header, snapshot.chunkIndex, 4);
+    appendInt(header, snapshot.totalChunks, 4);
+    appendInt(header, snapshot.iteration, 4);
+    appendInt(header, snapshot.totalIterations, 4);
+    appendInt(header, static_cast<int64_t>(compressedSize), 4);
+
+    fwrite(header.data(), 1, header.size(), m_file);
+    fwrite(m_compressed.data(), 1, compressedSize, m_file);
+    if (ferror(m_file)) {
+        throw std::runtime_error("[e] Error writing trace frame.");
+    }
+
+    m_frames++;
+}
+
+void TraceRecorder::close() {
+    if (m_file) {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+TraceReader::TraceReader(const std::string &path) : m_file(path, std::ios::binary) {
+    if (!m_file) {
+        throw std::runtime_error("[e] Error opening trace file for reading: " + path);
+    }
+
+    std::vector<uint8_t> header(TRACE_MAGIC.size() + 3);
+    m_file.read(reinterpret_cast<char *>(header.data()), header.size());
+    if (!m_file || FileManagementHelper::BytesToString({header.begin(), header.begin() + 4}) != TRACE_MAGIC) {
+        throw std::runtime_error("[e] Not a trace file: " + path);
+    }
+
+    int version = static_cast<int>(FileManagementHelper::BytesToInt({header.begin() + 4, header.begin() + 5}, 1));
+    int side = static_cast<int>(FileManagementHelper::BytesToInt({header.begin() + 5, header.end()}, 2));
+    if (version != TRACE_VERSION || side != SIDE) {
+        throw std::runtime_error("[e] Unsupported trace: version " + std::to_string(version) +
+                                 ", grid side " + std::to_string(side));
+    }
+
+    m_delta.resize(GRIDS_BYTES);
+}
+
+bool TraceReader::next(GridSnapshot &snapshot) {
+    std::vector<uint8_t> header(FRAME_HEADER_SIZE);
+    m_file.read(reinterpret_cast<char *>(header.data()), header.size());
+    if (m_file.gcount() == 0) {
+        return false;
+    }
+    if (!m_file) {
+        throw std::runtime_error("[e] Truncated trace frame header.");
+    }
+
+    auto field = [&](int index) {
+        auto begin = header.begin() + 1 + index * 4;
+        return static_cast<int>(FileManagementHelper::BytesToInt({begin, begin + 4}, 4));
+    };
+
+    const bool keyFrame = header[0] & 1;
+    const auto compressedSize = static_cast<uint32_t>(field(4));
+    if (compressedSize > compressBound(GRIDS_BYTES)) {
+        throw std::runtime_error("[e] Invalid trace frame size: " + std::to_string(compressedSize));
+    }
+
+    m_compressed.resize(compressedSize);
+    m_file.read(reinterpret_cast<char *>(m_compressed.data()), compressedSize);
+    if (!m_file) {
+        throw std::runtime_error("[e] Truncated trace frame.");
+    }
+
+    uLongf size = GRIDS_BYTES;
+    if (uncompress(m_delta.data(), &size, m_compressed.data(), compressedSize) != Z_OK || size != GRIDS_BYTES) {
+        throw std::runtime_error("[e] Corrupted trace frame.");
+    }
+
+    if (keyFrame) {
+        bytesToGrids(m_delta.data(), m_previous);
+    } else {
+        const auto *delta = reinterpret_cast<const uint64_t *>(m_delta.data());
+        for (int w = 0; w < GRID_WORDS; w++) {
+            m_previous.currentGrid[w] ^= delta[w];
+            m_previous.prevGrid[w] ^= delta[GRID_WORDS + w];
+        }
+    }
+
+    m_previous.chunkIndex = field(0);
+    m_previous.totalChunks = field(1);
+    m_previous.iteration = field(2);
+    m_previous.totalIterations = field(3);
+    snapshot = m_previous;
+    return true;
+}
+
+void TraceReader::exportY4M(const std::string &path, int framesPerSecond) {
+    std::ofstream video(path, std::ios::binary);
+    if (!video) {
+        throw std::runtime_error("[e] Error opening file for writing: " + path);
+    }
+
+    video << "YUV4MPEG2 W" << SIDE << " H" << SIDE << " F" << framesPerSecond << ":1 Ip A1:1 Cmono\n";
+
+    GridSnapshot snapshot;
+    std::vector<uint8_t> luma(BUFFER_SIZE);
+    while (next(snapshot)) {
+        for (int i = 0; i < BUFFER_SIZE; i++) {
+            luma[i] = (snapshot.currentGrid[i / 64] >> (i % 64)) & 1 ? 0 : 255;
+        }
+
+        video << "FRAME\n";
+        video.write(reinterpret_cast<const char *>(luma.data()), luma.size());
+    }
+
+    if (!video) {
+        throw std::runtime_error("[e] Error writing to file: " + path);
+    }
+}
+
+void TraceReader::exportPNG(const std::string &directory) {
+    std::filesystem::create_directories(directory);
+
+    GridSnapshot snapshot;
+    std::vector<uint8_t> cells(SIDE);
+    const size_t stride = (SIDE + 7) / 8;
+    std::vector<uint8_t> packed(stride * SIDE);
+
+    for (int frame = 0; next(snapshot); frame++) {
+        for (int y = 0; y < SIDE; y++) {
+            for (int x = 0; x < SIDE; x++) {
+                int i = y * SIDE + x;
+                cells[x] = (snapshot.currentGrid[i / 64] >> (i % 64)) & 1;
+            }
+            PhysicalStorage::PBMUtils::packRow(cells.data(), packed.data() + y * stride, SIDE);
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06d.png", frame);
+        std::string framePath = (std::filesystem::path(directory) / name).string();
+        if (!PhysicalStorage::PNGUtils::writeBilevelPNG(framePath, packed, SIDE, SIDE, 1)) {
+            throw std::runtime_error("[e] Error writing frame: " + framePath);
+        }
+    }
+}
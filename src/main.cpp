@@ -1,44 +1,371 @@
 #include "EGLManager.h"
 #include "GPUCellularAutomaton.h"
+#include "CPUCellularAutomaton.h"
+#include "ChunkScheduler.h"
+#include "DenisService.h"
 #include "PhysicalStorage/QRCodeStorage.hpp"
 #include "Encryption/EncryptionHelper.hpp"
 #include "Encryption/Key.h"
 #include "CellularAutomatonVisualizer.hpp"
+#include "SharedSnapshotRing.h"
 
 #include "main.hpp"
 
-int encode(std::string &src, std::string &dst, bool visualize = false) {
-    std::ifstream file(src, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file.\n";
-        return 1;
+// Which engine runs the automaton, and the rule it runs (encoding only: decoding
+// takes the rule from the file header)
+struct EngineOptions {
+    std::string engine = "gpu";
+    AutomatonRule rule;
+    int threads = 1;        // CPU engines: threads computing each generation (0 = all cores);
+                            // hybrid: CPU workers beside the GPU (0 = all cores but one)
+    int gpuStreams = 1;     // Hybrid: GPU engines submitting at once, each on its own thread and EGL context
+};
+
+std::unique_ptr<CellularAutomaton> makeEngine(const std::string &engine, const AutomatonRule &rule,
+                                              int threads = 1) {
+    if (engine == "gpu") {
+        return std::make_unique<GPUCellularAutomaton>(rule);
+    }
+    if (engine == "cpu") {
+        return std::make_unique<CPUCellularAutomaton>(rule, CPUKernel::BitSliced, threads);
+    }
+    if (engine == "cpu-lut") {
+        return std::make_unique<CPUCellularAutomaton>(rule, CPUKernel::Lookup, threads);
+    }
+    if (engine == "cpu-tiled") {
+        return std::make_unique<CPUCellularAutomaton>(rule, CPUKernel::BitSliced, threads, true);
     }
 
-    // Generate a secure encryption key
-    auto key = Key::generate();
+    throw std::invalid_argument("[e] Unknown engine: " + engine + ". Expected gpu, cpu, cpu-lut or cpu-tiled");
+}
+
+DenisAutomaton toDenisAutomaton(const AutomatonRule &rule) {
+    DenisAutomaton automaton;
+    automaton.flags = rule.topology == Topology::Toroidal ? DENIS_FLAG_TOROIDAL : 0;
+    if (rule.neighbourhood == Neighbourhood::Margolus) {
+        automaton.birth = rule.blockRule;
+        automaton.survive = 0;
+        automaton.flags |= DENIS_FLAG_MARGOLUS;
+    } else {
+        automaton.birth = rule.birth;
+        automaton.survive = rule.survive;
+    }
+    return automaton;
+}
+
+AutomatonRule fromDenisAutomaton(const DenisAutomaton &automaton) {
+    Topology topology = automaton.flags & DENIS_FLAG_TOROIDAL ? Topology::Toroidal : Topology::DeadBorder;
+    if (automaton.flags & DENIS_FLAG_MARGOLUS) {
+        return AutomatonRule::margolus(automaton.birth, topology);
+    }
+
+    AutomatonRule rule;
+    rule.birth = static_cast<uint16_t>(automaton.birth);
+    rule.survive = static_cast<uint16_t>(automaton.survive);
+    rule.topology = topology;
+    return rule;
+}
+
+// How a run is observed: in a live window, recorded to a trace file, shared
+// with denis-view processes and/or summarised per generation in a CSV file
+struct ObserveOptions {
+    bool visualize = false;
+    int sampleEvery = 0;
+    std::string recordPath;
+    std::string shareName;
+    std::string statsPath;
+};
 
-    // Display key with better formatting
+// Generations handed to the observers: every `every`th one, or when 0 one per
+// display frame (a few per second when only recording), plus the last one of
+// each chunk. Copies are read back asynchronously, so sampling never stalls the
+// automaton; samples are dropped when the GPU is still busy copying
+struct GenerationSampling {
+    int every = 0;
+    std::chrono::microseconds period{1000000 / 60};
+    CellularAutomatonVisualizer *visualizer = nullptr;
+    std::unique_ptr<TraceRecorder> recorder;
+    std::unique_ptr<SharedSnapshotPublisher> publisher;
+    std::chrono::steady_clock::time_point next{};
+    GridSnapshot snapshot{};
+
+    GenerationSampling(const ObserveOptions &observe, CellularAutomatonVisualizer &window) : every(observe.sampleEvery) {
+        if (observe.visualize) {
+            visualizer = &window;
+        }
+        if (!observe.recordPath.empty()) {
+            recorder = std::make_unique<TraceRecorder>(observe.recordPath);
+            if (!visualizer) {
+                period = std::chrono::microseconds(1000000 / 4);
+            }
+        }
+        if (!observe.shareName.empty()) {
+            publisher = std::make_unique<SharedSnapshotPublisher>(observe.shareName);
+        }
+    }
+
+    // A shared ring only costs something while a viewer is attached
+    bool active() const { return visualizer || recorder || (publisher && publisher->hasViewers()); }
+};
+
+void sampleGeneration(CellularAutomaton &engine, GenerationSampling &sampling, int chunk, int totalChunks,
+                      int iteration, int totalIterations) {
+    const bool lastGeneration = iteration == totalIterations;
+
+    bool due;
+    if (sampling.every > 0) {
+        due = iteration % sampling.every == 0 || lastGeneration;
+    } else {
+        auto now = std::chrono::steady_clock::now();
+        due = now >= sampling.next || lastGeneration;
+        if (due) {
+            sampling.next = now + sampling.period;
+        }
+    }
+
+    if (due) {
+        engine.requestSnapshot(iteration);
+    }
+
+    // The chunk's last generation is waited for, so it is never attributed to the next chunk
+    GridSnapshot &snapshot = sampling.snapshot;
+    if (engine.pollSnapshot(snapshot.currentGrid, snapshot.prevGrid, snapshot.iteration, lastGeneration)) {
+        snapshot.chunkIndex = chunk;
+        snapshot.totalChunks = totalChunks;
+        snapshot.totalIterations = totalIterations;
+
+        if (sampling.visualizer) {
+            sampling.visualizer->updateGridState(snapshot.currentGrid, snapshot.prevGrid, chunk, totalChunks,
+                                                 snapshot.iteration, totalIterations);
+        }
+        if (sampling.recorder) {
+            sampling.recorder->record(snapshot);
+        }
+        if (sampling.publisher) {
+            sampling.publisher->publish(snapshot);
+        }
+    }
+}
+
+// Opens the --stats CSV, or returns null when statistics are off
+std::unique_ptr<std::ofstream> openStats(const std::string &path) {
+    if (path.empty()) {
+        return nullptr;
+    }
+
+    auto csv = std::make_unique<std::ofstream>(path);
+    if (!*csv) {
+        throw std::runtime_error("[e] Error opening statistics file for writing: " + path);
+    }
+    *csv << "chunk,generation,live,changed\n";
+    return csv;
+}
+
+// Appends one chunk's statistics, generation 0 being the chunk's initial state
+void writeStats(std::ofstream &csv, int chunk, const std::vector<GenerationStats> &stats) {
+    for (size_t generation = 0; generation < stats.size(); generation++) {
+        csv << chunk << ',' << generation << ',' << stats[generation].live << ',' << stats[generation].changed << '\n';
+    }
+}
+
+// Unpacks a chunk into cells, most significant bit of each byte first; cells past `count` bytes are dead
+void bytesToGrid(const uint8_t *bytes, size_t count, std::array<int, BUFFER_SIZE> &grid) {
+    for (size_t i = 0; i < BUFFER_SIZE / 8; i++) {
+        const uint8_t byte = i < count ? bytes[i] : 0;
+        for (int b = 0; b < 8; b++) {
+            grid[i * 8 + b] = byte >> (7 - b) & 1;
+        }
+    }
+}
+
+// Packs the cells into BUFFER_SIZE / 8 bytes, most significant bit of each byte first
+void gridToBytes(const std::array<int, BUFFER_SIZE> &grid, uint8_t *bytes) {
+    for (size_t i = 0; i < BUFFER_SIZE / 8; i++) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) {
+            byte |= grid[i * 8 + b] << (7 - b);
+        }
+        bytes[i] = byte;
+    }
+}
+
+// A file whose chunks run along with those of other files, encoded or decoded with its own key
+struct ChunkedFile {
+    std::vector<uint8_t> input;     // Plain bytes, or the encoded chunks of a DENIS file
+    const Key *key = nullptr;
+    int padding = 0;                // Decoding: bytes dropped from the end of the last chunk
+    std::vector<uint8_t> output;    // Encoded chunks laid out as by encode(), or the decoded bytes
+};
+
+// Encodes a chunk of `file` on an engine: each chunk's previous grid (Moore rules) then current grid
+void encodeChunk(CellularAutomaton &engine, ChunkedFile &file, std::size_t chunk, bool secondOrder) {
+    constexpr std::size_t chunk_size = BUFFER_SIZE / 8;
+    const std::size_t offset = chunk * chunk_size;
+    std::vector<uint8_t> buffer(file.input.begin() + offset,
+                                file.input.begin() + std::min(offset + chunk_size, file.input.size()));
+    EncryptionHelper::Encrypt(buffer, file.key->XORKey);
+
+    auto grid = std::make_unique<std::array<int, BUFFER_SIZE>>();
+    bytesToGrid(buffer.data(), buffer.size(), *grid);
+    engine.clearPrevGrid();
+    engine.writeCurrGrid(*grid);
+    engine.setGeneration(0);
+    engine.runForwardBy(file.key->iter);
+
+    uint8_t *out = file.output.data() + chunk * (secondOrder ? 2 : 1) * chunk_size;
+    if (secondOrder) {
+        engine.readPrevGrid(*grid);
+        gridToBytes(*grid, out);
+        out += chunk_size;
+    }
+    engine.readCurrGrid(*grid);
+    gridToBytes(*grid, out);
+}
+
+void decodeChunk(CellularAutomaton &engine, ChunkedFile &file, std::size_t chunk, bool secondOrder) {
+    constexpr std::size_t chunk_size = BUFFER_SIZE / 8;
+    const uint8_t *in = file.input.data() + chunk * (secondOrder ? 2 : 1) * chunk_size;
+    auto grid = std::make_unique<std::array<int, BUFFER_SIZE>>();
+    if (secondOrder) {
+        bytesToGrid(in, chunk_size, *grid);
+        engine.writePrevGrid(*grid);
+        in += chunk_size;
+    } else {
+        engine.clearPrevGrid();
+    }
+    bytesToGrid(in, chunk_size, *grid);
+    engine.writeCurrGrid(*grid);
+    engine.setGeneration(file.key->iter);
+    engine.runBackwardBy(file.key->iter);
+
+    std::vector<uint8_t> bytes(chunk_size);
+    engine.readCurrGrid(*grid);
+    gridToBytes(*grid, bytes.data());
+    EncryptionHelper::Decrypt(bytes, file.key->XORKey);
+    std::copy(bytes.begin(), bytes.end(), file.output.begin() + chunk * chunk_size);
+}
+
+// Encodes or decodes the chunks of all files at once, on the scheduler's GPU and CPU
+// workers; the files share the scheduler's rule but not their keys
+void runChunks(ChunkScheduler &scheduler, const AutomatonRule &rule, bool encoding,
+               const std::vector<ChunkedFile *> &files) {
+    constexpr std::size_t chunk_size = BUFFER_SIZE / 8;
+    const bool secondOrder = rule.secondOrder();
+    const std::size_t chunkBytes = (secondOrder ? 2 : 1) * chunk_size;
+
+    // One list of every file's chunks, each running its file's iterations
+    std::vector<std::pair<ChunkedFile *, std::size_t>> chunks;
+    std::vector<long long> generations;
+    for (ChunkedFile *file : files) {
+        const std::size_t count = encoding ? (file->input.size() + chunk_size - 1) / chunk_size
+                                           : file->input.size() / chunkBytes;
+        file->output.assign(count * (encoding ? chunkBytes : chunk_size), 0);
+        for (std::size_t chunk = 0; chunk < count; chunk++) {
+            chunks.emplace_back(file, chunk);
+            generations.push_back(file->key->iter);
+        }
+    }
+
+    scheduler.run(generations, [&](CellularAutomaton &engine, size_t index) {
+        auto [file, chunk] = chunks[index];
+        if (encoding) {
+            encodeChunk(engine, *file, chunk, secondOrder);
+        } else {
+            decodeChunk(engine, *file, chunk, secondOrder);
+        }
+    });
+
+    if (!encoding) {
+        for (ChunkedFile *file : files) {
+            if (!file->output.empty()) {
+                const std::size_t padding = std::min<std::size_t>(std::max(file->padding, 0), chunk_size);
+                file->output.resize(file->output.size() - padding);
+            }
+        }
+    }
+}
+
+// Bytes the last chunk of an `inputSize`-byte file is padded with when encoded in one piece
+int lastChunkPadding(std::size_t inputSize) {
+    constexpr std::size_t chunk_size = BUFFER_SIZE / 8;
+    const std::size_t lastChunkBytes = inputSize == 0 ? 0 : (inputSize - 1) % chunk_size + 1;
+    return static_cast<int>(chunk_size - lastChunkBytes);
+}
+
+// Wraps the encoded chunks in a DENIS container
+std::vector<uint8_t> packDenis(std::vector<uint8_t> &data, int padding, const AutomatonRule &rule) {
+    DenisEncoder enc(3);
+    enc.SetAutomaton(toDenisAutomaton(rule));
+    return enc.EncodeToBuffer(data, DenisExtensionType::ANY, padding);
+}
+
+// Wraps the encoded chunks in a DENIS container, kept in memory so later stages
+// (QR pages) need not read it back, and writes it to `dst`
+void saveDenis(std::vector<uint8_t> &data, int padding, const AutomatonRule &rule, std::string &dst,
+               std::vector<uint8_t> &denis) {
+    denis = packDenis(data, padding, rule);
+    FileManagementHelper::WriteBuffer(dst, denis);
+}
+
+// Display key with better formatting
+void showKey(const std::string &key) {
     std::cout << "┌─────────────────────────────────────────┐" << std::endl;
     std::cout << "│          !!! DECRYPTION KEY !!!         │" << std::endl;
     std::cout << "├─────────────────────────────────────────┤" << std::endl;
-    std::cout << "│ " << std::left << std::setw(39) << key.toString() << " │" << std::endl;
+    std::cout << "│ " << std::left << std::setw(39) << key << " │" << std::endl;
     std::cout << "└─────────────────────────────────────────┘" << std::endl;
     std::cout << "⚠️  WARNING: SAVE THIS KEY NOW  ⚠️" << std::endl;
     std::cout << "Without this key, your file will be PERMANENTLY LOST" << std::endl;
     std::cout << "and IMPOSSIBLE to recover by ANY means." << std::endl;
+}
+
+int encode(std::string &src, std::string &dst, std::vector<uint8_t> &denis, const EngineOptions &options = {},
+           const ObserveOptions &observe = {}) {
+    std::ifstream file(src, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open file.\n";
+        return 1;
+    }
+
+    // Generate a secure encryption key
+    auto key = Key::generate();
+
+    showKey(key.toString());
 
     constexpr std::size_t chunk_size = BUFFER_SIZE / 8;
+
+    // Hybrid runs take all chunks at once
+    if (options.engine == "hybrid") {
+        ChunkedFile chunked;
+        chunked.input.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        chunked.key = &key;
+
+        ChunkScheduler scheduler(options.rule, options.threads, options.gpuStreams);
+        runChunks(scheduler, options.rule, true, {&chunked});
+        std::cout << "Chunks run on the GPU: " << scheduler.gpuChunks() << ", on the CPU: " << scheduler.cpuChunks()
+                  << std::endl;
+
+        saveDenis(chunked.output, lastChunkPadding(chunked.input.size()), options.rule, dst, denis);
+
+        std::cout << "Encoding complete! File saved to: " << dst << std::endl;
+        return 0;
+    }
+
     std::vector<uint8_t> buffer(chunk_size);
 
     std::array<int, BUFFER_SIZE> current_grid{};
     std::array<int, BUFFER_SIZE> prev_grid{};
-    GPUCellularAutomaton engine;
+    std::unique_ptr<CellularAutomaton> automaton = makeEngine(options.engine, options.rule, options.threads);
+    CellularAutomaton &engine = *automaton;
 
     std::vector<uint8_t> data;
     std::streamsize bytes_read = 0;
 
-    // Initialize visualizer if requested
+    // Initialize visualizer and other observers if requested
+    const bool visualize = observe.visualize;
     CellularAutomatonVisualizer visualizer("Denis File Encoder Visualization");
+    GenerationSampling sampling(observe, visualizer);
+    auto stats = openStats(observe.statsPath);
     if (visualize) {
         visualizer.start();
     }
@@ -54,45 +381,48 @@ int encode(std::string &src, std::string &dst, bool visualize = false) {
         // Read chunk
         file.read(reinterpret_cast<char *>(buffer.data()), chunk_size);
 
+        // The last chunk read keeps its size, for the padding
+        if (file.gcount() == 0) break; // End of file
         bytes_read = file.gcount();
-        if (bytes_read == 0) break; // End of file
 
         EncryptionHelper::Encrypt(buffer, key.XORKey);
-
-        std::size_t bitIndex = 0;
-        for (std::streamsize i = 0; i < chunk_size; i++) {
-            // Convert each byte to bits
-            std::bitset<8> bits(buffer[i]);
-            for (int b = 7; b >= 0; --b) {
-                if (i < bytes_read)
-                    current_grid[bitIndex++] = bits[b];
-                else
-                    current_grid[bitIndex++] = 0;
-            }
-        }
+        bytesToGrid(buffer.data(), bytes_read, current_grid);
 
         // Upload arrays to the GPU
         engine.clearPrevGrid();
         engine.writeCurrGrid(current_grid);
+        engine.setGeneration(0);
 
-        // Update visualizer with initial state if requested
-        if (visualize) {
-            engine.readPrevGrid(prev_grid);
-            visualizer.updateGridState(current_grid, prev_grid, currentChunk, totalChunks, 0, key.iter);
+        // Sample the initial state if requested
+        if (sampling.active()) {
+            sampleGeneration(engine, sampling, currentChunk, totalChunks, 0, key.iter);
+        }
+        if (stats) {
+            engine.beginStats(key.iter + 1);
+            engine.recordStats();
         }
 
-        // Run iterations
-        for (int i = 0; i < key.iter && (visualize ? visualizer.isRunning() : true); i++) {
+        // Run iterations, all at once when no one watches them
+        const bool observed = sampling.active() || stats;
+        if (!observed) {
+            engine.runForwardBy(key.iter);
+        }
+        for (int i = 0; observed && i < key.iter && (visualize ? visualizer.isRunning() : true); i++) {
             engine.runForward();
 
-            // Update visualizer on every iteration if requested
-            if (visualize) {
-                engine.readCurrGrid(current_grid);
-                engine.readPrevGrid(prev_grid);
-                visualizer.updateGridState(current_grid, prev_grid, currentChunk, totalChunks, i + 1, key.iter);
+            // Sample generations if requested
+            if (sampling.active()) {
+                sampleGeneration(engine, sampling, currentChunk, totalChunks, i + 1, key.iter);
+            }
+            if (stats) {
+                engine.recordStats();
             }
         }
 
+        if (stats) {
+            writeStats(*stats, currentChunk, engine.readStats());
+        }
+
         // Check if visualizer was closed by user
         if (visualize && !visualizer.isRunning()) {
             break;
@@ -102,21 +432,14 @@ int encode(std::string &src, std::string &dst, bool visualize = false) {
         engine.readCurrGrid(current_grid);
         engine.readPrevGrid(prev_grid);
 
-        for (size_t i = 0; i < prev_grid.size(); i += 8) {
-            uint8_t byte = 0;
-            for (int b = 0; b < 8 && i + b < prev_grid.size(); ++b) {
-                byte |= prev_grid[i + b] << 7 - b;
-            }
-            data.push_back(byte);
+        // Block rules are reversible from the current grid alone
+        if (options.rule.secondOrder()) {
+            data.resize(data.size() + chunk_size);
+            gridToBytes(prev_grid, data.data() + data.size() - chunk_size);
         }
 
-        for (size_t i = 0; i < current_grid.size(); i += 8) {
-            uint8_t byte = 0;
-            for (int b = 0; b < 8 && i + b < current_grid.size(); ++b) {
-                byte |= current_grid[i + b] << 7 - b;
-            }
-            data.push_back(byte);
-        }
+        data.resize(data.size() + chunk_size);
+        gridToBytes(current_grid, data.data() + data.size() - chunk_size);
 
         currentChunk++;
     }
@@ -126,15 +449,15 @@ int encode(std::string &src, std::string &dst, bool visualize = false) {
         visualizer.stop();
     }
 
-    DenisEncoder enc(2);
-    enc.Encode(dst, data, DenisExtensionType::ANY, chunk_size - bytes_read);
+    saveDenis(data, chunk_size - bytes_read, options.rule, dst, denis);
 
     file.close();
     std::cout << "Encoding complete! File saved to: " << dst << std::endl;
     return 0;
 }
 
-int decode(std::string &src, std::string &dst, const Key &key, bool visualize = false) {
+int decode(const std::vector<uint8_t> &denis, std::string &dst, const Key &key, const EngineOptions &options = {},
+           const ObserveOptions &observe = {}) {
     std::ofstream file(dst, std::ios::binary);
     if (!file) {
         std::cerr << "Failed to open file.\n";
@@ -148,67 +471,95 @@ int decode(std::string &src, std::string &dst, const Key &key, bool visualize =
     std::cout << "│ " << std::left << std::setw(39) << key.toString() << " │" << std::endl;
     std::cout << "└─────────────────────────────────────────┘" << std::endl;
 
-    DenisDecoder dec(2);
+    DenisDecoder dec(3);
     std::array<int, BUFFER_SIZE> grid{};
-    GPUCellularAutomaton engine;
 
-    // Initialize visualizer if requested
+    // Initialize visualizer and other observers if requested
+    const bool visualize = observe.visualize;
     CellularAutomatonVisualizer visualizer("Denis File Decoder Visualization");
+    GenerationSampling sampling(observe, visualizer);
+    auto stats = openStats(observe.statsPath);
     if (visualize) {
         visualizer.start();
     }
 
     // Decode the input file
     std::cout << "Reading encoded file..." << std::endl;
-    auto [header, encoded_bytes] = dec.Decode(src);
+    auto [header, encoded_bytes] = dec.Decode(denis);
+
+    // Run the automaton the file was encoded with
+    const AutomatonRule rule = fromDenisAutomaton(header.automaton);
+    if (options.engine == "hybrid") {
+        ChunkedFile chunked;
+        chunked.input = std::move(encoded_bytes);
+        chunked.key = &key;
+        chunked.padding = header.padding;
+
+        ChunkScheduler scheduler(rule, options.threads, options.gpuStreams);
+        runChunks(scheduler, rule, false, {&chunked});
+        std::cout << "Chunks run on the GPU: " << scheduler.gpuChunks() << ", on the CPU: " << scheduler.cpuChunks()
+                  << std::endl;
+        file.write(reinterpret_cast<char *>(chunked.output.data()), chunked.output.size());
+
+        file.close();
+        std::cout << "\nDecoding complete! File saved to: " << dst << std::endl;
+        return 0;
+    }
+
+    std::unique_ptr<CellularAutomaton> automaton = makeEngine(options.engine, rule, options.threads);
+    CellularAutomaton &engine = *automaton;
     std::vector<uint8_t> decoded_bytes;
 
     // Calculate total number of chunks for progress tracking
-    int i = 0;
-    int totalChunks = encoded_bytes.size() / (BUFFER_SIZE / 4); // Approximation
+    const std::size_t chunkBytes = (rule.secondOrder() ? 2 : 1) * BUFFER_SIZE / 8;
+    std::size_t i = 0;
+    int totalChunks = encoded_bytes.size() / chunkBytes;
     int currentChunk = 0;
 
-    while (i < encoded_bytes.size() && (visualize ? visualizer.isRunning() : true)) {
-        std::size_t bitIndex = 0;
-        for (std::streamsize j = 0; j < BUFFER_SIZE / 8; j++) {
-            // Convert each byte to bits
-            std::bitset<8> bits(encoded_bytes[i++]);
-            for (int b = 7; b >= 0; --b) {
-                grid[bitIndex++] = bits[b];
-            }
+    while (i + chunkBytes <= encoded_bytes.size() && (visualize ? visualizer.isRunning() : true)) {
+        if (rule.secondOrder()) {
+            bytesToGrid(encoded_bytes.data() + i, BUFFER_SIZE / 8, grid);
+            i += BUFFER_SIZE / 8;
+            engine.writePrevGrid(grid);
+        } else {
+            // Block rules store the current grid only
+            engine.clearPrevGrid();
         }
-        engine.writePrevGrid(grid);
 
-        bitIndex = 0;
-        for (std::streamsize j = 0; j < BUFFER_SIZE / 8; j++) {
-            // Convert each byte to bits
-            std::bitset<8> bits(encoded_bytes[i++]);
-            for (int b = 7; b >= 0; --b) {
-                grid[bitIndex++] = bits[b];
-            }
-        }
+        bytesToGrid(encoded_bytes.data() + i, BUFFER_SIZE / 8, grid);
+        i += BUFFER_SIZE / 8;
         engine.writeCurrGrid(grid);
+        engine.setGeneration(key.iter);
 
-        // Update visualizer with initial state if requested
-        if (visualize) {
-            std::array<int, BUFFER_SIZE> prev_grid{};
-            engine.readPrevGrid(prev_grid);
-            engine.readCurrGrid(grid);
-            visualizer.updateGridState(grid, prev_grid, currentChunk, totalChunks, 0, key.iter);
+        // Sample the initial state if requested
+        if (sampling.active()) {
+            sampleGeneration(engine, sampling, currentChunk, totalChunks, 0, key.iter);
+        }
+        if (stats) {
+            engine.beginStats(key.iter + 1);
+            engine.recordStats();
         }
 
-        for (int j = 0; j < key.iter && (visualize ? visualizer.isRunning() : true); j++) {
+        const bool observed = sampling.active() || stats;
+        if (!observed) {
+            engine.runBackwardBy(key.iter);
+        }
+        for (int j = 0; observed && j < key.iter && (visualize ? visualizer.isRunning() : true); j++) {
             engine.runBackward();
 
-            // Update visualizer on every iteration if requested
-            if (visualize) {
-                std::array<int, BUFFER_SIZE> prev_grid{};
-                engine.readPrevGrid(prev_grid);
-                engine.readCurrGrid(grid);
-                visualizer.updateGridState(grid, prev_grid, currentChunk, totalChunks, j + 1, key.iter);
+            // Sample generations if requested
+            if (sampling.active()) {
+                sampleGeneration(engine, sampling, currentChunk, totalChunks, j + 1, key.iter);
+            }
+            if (stats) {
+                engine.recordStats();
             }
         }
 
+        if (stats) {
+            writeStats(*stats, currentChunk, engine.readStats());
+        }
+
         // Check if visualizer was closed by user
         if (visualize && !visualizer.isRunning()) {
             break;
@@ -216,16 +567,12 @@ int decode(std::string &src, std::string &dst, const Key &key, bool visualize =
 
         engine.readCurrGrid(grid);
 
-        bool is_final_chunk = encoded_bytes.size() - i <= BUFFER_SIZE / 8;
-        int padding = is_final_chunk ? header.padding * 8 : 0;
+        bool is_final_chunk = i + chunkBytes > encoded_bytes.size();
+        int padding = is_final_chunk ? header.padding : 0;
 
-        for (size_t j = 0; j < grid.size() - padding; j += 8) {
-            uint8_t byte = 0;
-            for (int b = 0; b < 8 && j + b < grid.size(); ++b) {
-                byte |= grid[j + b] << 7 - b;
-            }
-            decoded_bytes.push_back(byte);
-        }
+        decoded_bytes.resize(BUFFER_SIZE / 8);
+        gridToBytes(grid, decoded_bytes.data());
+        decoded_bytes.resize(BUFFER_SIZE / 8 - padding);
 
         EncryptionHelper::Decrypt(decoded_bytes, key.XORKey);
         file.write(reinterpret_cast<char *>(decoded_bytes.data()), decoded_bytes.size());
@@ -244,28 +591,453 @@ int decode(std::string &src, std::string &dst, const Key &key, bool visualize =
     return 0;
 }
 
-int main(int argc, char **argv) {
-    EGLManager::init();
+// Input bytes a batch loads and runs at once: enough small files to keep every
+// worker busy, few enough to bound the memory a long list takes
+constexpr std::size_t BATCH_WINDOW_BYTES = 64 << 20;
+
+// The lines of a batch list split at tabs, skipping blank lines and # comments
+std::vector<std::vector<std::string>> readBatchList(const std::string &path) {
+    std::ifstream list(path);
+    if (!list) {
+        throw std::runtime_error("[e] Error opening batch list for reading: " + path);
+    }
+
+    std::vector<std::vector<std::string>> lines;
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::size_t start = 0;
+        for (std::size_t tab; (tab = line.find('\t', start)) != std::string::npos; start = tab + 1) {
+            fields.push_back(line.substr(start, tab - start));
+        }
+        fields.push_back(line.substr(start));
+        lines.push_back(fields);
+    }
+    return lines;
+}
+
+// One file of a batch, kept in memory until its window is written
+struct BatchFile {
+    std::string input;
+    std::string output;
+    Key key;
+    AutomatonRule rule;
+    ChunkedFile chunked;
 
+    BatchFile(std::string input, std::string output, Key key)
+        : input(std::move(input)), output(std::move(output)), key(std::move(key)) {
+        chunked.key = &this->key;
+    }
+};
+
+// Loads the files of the next window from `lines`, starting at `next`; `load` fills in
+// a file from its list line and throws to skip it, which counts it in `failed`
+std::vector<std::unique_ptr<BatchFile>> loadBatchWindow(
+        const std::vector<std::vector<std::string>> &lines, std::size_t &next, std::size_t &failed,
+        const std::function<std::unique_ptr<BatchFile>(const std::vector<std::string> &fields)> &load) {
+    std::vector<std::unique_ptr<BatchFile>> window;
+    std::size_t windowBytes = 0;
+    for (; next < lines.size() && windowBytes < BATCH_WINDOW_BYTES; next++) {
+        try {
+            window.push_back(load(lines[next]));
+            windowBytes += window.back()->chunked.input.size();
+        } catch (const std::exception &e) {
+            std::cerr << "Skipping " << lines[next][0] << ": " << e.what() << std::endl;
+            failed++;
+        }
+    }
+    return window;
+}
+
+// Encodes every file of the list (one path per line) into `outdir` with its own key,
+// running all of them on one set of engines; the keys go to `outdir`/manifest.tsv,
+// which decodeBatch() takes as its list. Returns 1 if any file failed
+int encodeBatch(const std::string &listPath, const std::string &outdir, const EngineOptions &options) {
+    const auto lines = readBatchList(listPath);
+    std::filesystem::create_directories(outdir);
+
+    // The keys decrypt every file, so only the owner may read them
+    const std::string manifestPath = (std::filesystem::path(outdir) / "manifest.tsv").string();
+    std::unique_ptr<FILE, int (*)(FILE *)> manifest(FileManagementHelper::CreatePrivate(manifestPath), fclose);
+    fputs("# input\toutput\tkey\n", manifest.get());
+
+    ChunkScheduler scheduler(options.rule, options.threads, options.gpuStreams);
+    std::set<std::string> outputs;
+    std::size_t next = 0, encoded = 0, failed = 0, gpuChunks = 0, cpuChunks = 0;
+    while (next < lines.size()) {
+        auto window = loadBatchWindow(lines, next, failed, [&](const std::vector<std::string> &fields) {
+            const std::filesystem::path input(fields[0]);
+            const std::string output = (std::filesystem::path(outdir) / input.filename()).string() + ".denis";
+            if (!outputs.insert(output).second) {
+                throw std::runtime_error("[e] Output already written by an earlier file: " + output);
+            }
+
+            auto file = std::make_unique<BatchFile>(fields[0], output, Key::generate());
+            file->chunked.input = FileManagementHelper::ReadBuffer(fields[0]);
+            return file;
+        });
+
+        std::vector<ChunkedFile *> chunked;
+        for (auto &file : window) {
+            chunked.push_back(&file->chunked);
+        }
+        runChunks(scheduler, options.rule, true, chunked);
+        gpuChunks += scheduler.gpuChunks();
+        cpuChunks += scheduler.cpuChunks();
+
+        for (auto &file : window) {
+            try {
+                const int padding = lastChunkPadding(file->chunked.input.size());
+                std::vector<uint8_t> denis;
+                saveDenis(file->chunked.output, padding, options.rule, file->output, denis);
+                const std::string entry = file->input + '\t' + file->output + '\t' + file->key.toString() + '\n';
+                fputs(entry.c_str(), manifest.get());
+                encoded++;
+            } catch (const std::exception &e) {
+                std::cerr << "Skipping " << file->input << ": " << e.what() << std::endl;
+                failed++;
+            }
+        }
+        if (fflush(manifest.get()) != 0) {
+            throw std::runtime_error("[e] Error writing manifest: " + manifestPath);
+        }
+    }
+
+    std::cout << "Chunks run on the GPU: " << gpuChunks << ", on the CPU: " << cpuChunks << std::endl;
+    std::cout << "Encoded " << encoded << " of " << encoded + failed << " files into " << outdir
+              << ", keys saved to: " << manifestPath << std::endl;
+    return failed > 0 ? 1 : 0;
+}
+
+// Decodes every file of the list into `outdir`, a line holding a DENIS file and its key
+// as the last two tab-separated fields, as in an encoding manifest. Files are grouped
+// by the rule their header records, each rule running on its own engines; outputs are
+// named after the input without its .denis extension. Returns 1 if any file failed
+int decodeBatch(const std::string &listPath, const std::string &outdir, const EngineOptions &options) {
+    const auto lines = readBatchList(listPath);
+    std::filesystem::create_directories(outdir);
+
+    std::map<std::string, std::unique_ptr<ChunkScheduler>> schedulers;
+    std::set<std::string> outputs;
+    std::size_t next = 0, decoded = 0, failed = 0, gpuChunks = 0, cpuChunks = 0;
+    while (next < lines.size()) {
+        auto window = loadBatchWindow(lines, next, failed, [&](const std::vector<std::string> &fields) {
+            if (fields.size() < 2) {
+                throw std::invalid_argument("[e] Missing key, expected a DENIS file and its key separated by a tab");
+            }
+
+            const std::filesystem::path input(fields[fields.size() - 2]);
+            const std::string name = input.extension() == ".denis" ? input.stem().string()
+                                                                   : input.filename().string() + ".out";
+            const std::string output = (std::filesystem::path(outdir) / name).string();
+            if (!outputs.insert(output).second) {
+                throw std::runtime_error("[e] Output already written by an earlier file: " + output);
+            }
+
+            auto file = std::make_unique<BatchFile>(input.string(), output, Key(fields.back()));
+            DenisDecoder dec(3);
+            auto [header, encoded_bytes] = dec.Decode(FileManagementHelper::ReadBuffer(input.string()));
+            file->rule = fromDenisAutomaton(header.automaton);
+            file->chunked.input = std::move(encoded_bytes);
+            file->chunked.padding = header.padding;
+            return file;
+        });
+
+        // Files sharing a rule run together
+        std::map<std::string, std::vector<BatchFile *>> groups;
+        for (auto &file : window) {
+            groups[file->rule.notation() + " " + file->rule.topologyName()].push_back(file.get());
+        }
+        for (auto &[name, files] : groups) {
+            const AutomatonRule &rule = files.front()->rule;
+            std::unique_ptr<ChunkScheduler> &scheduler = schedulers[name];
+            if (!scheduler) {
+                scheduler = std::make_unique<ChunkScheduler>(rule, options.threads, options.gpuStreams);
+            }
+
+            std::vector<ChunkedFile *> chunked;
+            for (BatchFile *file : files) {
+                chunked.push_back(&file->chunked);
+            }
+            runChunks(*scheduler, rule, false, chunked);
+            gpuChunks += scheduler->gpuChunks();
+            cpuChunks += scheduler->cpuChunks();
+        }
+
+        for (auto &file : window) {
+            try {
+                FileManagementHelper::WriteBuffer(file->output, file->chunked.output);
+                decoded++;
+            } catch (const std::exception &e) {
+                std::cerr << "Skipping " << file->input << ": " << e.what() << std::endl;
+                failed++;
+            }
+        }
+    }
+
+    std::cout << "Chunks run on the GPU: " << gpuChunks << ", on the CPU: " << cpuChunks << std::endl;
+    std::cout << "Decoded " << decoded << " of " << decoded + failed << " files into " << outdir << std::endl;
+    return failed > 0 ? 1 : 0;
+}
+
+DenisServer *runningServer = nullptr;
+
+void stopServer(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+}
+
+// Runs one round of service requests: every job's file is loaded, the chunks of all
+// jobs sharing a rule run together as in a batch, then the outputs are written back
+void runServiceRound(const std::vector<ServiceJob *> &jobs, const EngineOptions &options,
+                     std::map<std::string, std::unique_ptr<ChunkScheduler>> &schedulers) {
+    std::vector<std::unique_ptr<BatchFile>> files(jobs.size());
+    for (std::size_t j = 0; j < jobs.size(); j++) {
+        ServiceJob &job = *jobs[j];
+        if (job.reply.status != 0) {
+            continue;
+        }
+        try {
+            if (job.request.operation == ServiceOperation::Encode) {
+                files[j] = std::make_unique<BatchFile>("", "", Key::generate());
+                files[j]->rule = AutomatonRule::parse(job.request.rule,
+                                                      AutomatonRule::parseTopology(job.request.topology));
+                files[j]->chunked.input = job.readInput();
+            } else if (job.request.operation == ServiceOperation::Decode) {
+                files[j] = std::make_unique<BatchFile>("", "", Key(job.request.key));
+                DenisDecoder dec(3);
+                auto [header, encoded_bytes] = dec.Decode(job.readInput());
+                files[j]->rule = fromDenisAutomaton(header.automaton);
+                files[j]->chunked.input = std::move(encoded_bytes);
+                files[j]->chunked.padding = header.padding;
+            } else {
+                throw std::invalid_argument("[e] Unknown operation");
+            }
+        } catch (const std::exception &e) {
+            job.fail(e.what());
+            files[j].reset();
+        }
+    }
+
+    // Jobs sharing a rule and a direction run together, each rule on its own engines
+    std::map<std::pair<std::string, bool>, std::vector<std::size_t>> groups;
+    for (std::size_t j = 0; j < jobs.size(); j++) {
+        if (files[j]) {
+            const bool encoding = jobs[j]->request.operation == ServiceOperation::Encode;
+            groups[{files[j]->rule.notation() + " " + files[j]->rule.topologyName(), encoding}].push_back(j);
+        }
+    }
+    for (auto &[group, members] : groups) {
+        const AutomatonRule &rule = files[members.front()]->rule;
+        std::unique_ptr<ChunkScheduler> &scheduler = schedulers[group.first];
+        if (!scheduler) {
+            scheduler = std::make_unique<ChunkScheduler>(rule, options.threads, options.gpuStreams);
+        }
+
+        std::vector<ChunkedFile *> chunked;
+        for (std::size_t j : members) {
+            chunked.push_back(&files[j]->chunked);
+        }
+        try {
+            runChunks(*scheduler, rule, group.second, chunked);
+        } catch (const std::exception &e) {
+            for (std::size_t j : members) {
+                jobs[j]->fail(e.what());
+                files[j].reset();
+            }
+        }
+    }
+
+    for (std::size_t j = 0; j < jobs.size(); j++) {
+        if (!files[j]) {
+            continue;
+        }
+        try {
+            ChunkedFile &chunked = files[j]->chunked;
+            if (jobs[j]->request.operation == ServiceOperation::Encode) {
+                jobs[j]->writeOutput(packDenis(chunked.output, lastChunkPadding(chunked.input.size()), files[j]->rule));
+                const std::string key = files[j]->key.toString();
+                std::strncpy(jobs[j]->reply.key, key.c_str(), sizeof(jobs[j]->reply.key) - 1);
+            } else {
+                jobs[j]->writeOutput(chunked.output);
+            }
+        } catch (const std::exception &e) {
+            jobs[j]->fail(e.what());
+        }
+    }
+}
+
+// Serves encode and decode requests on a Unix socket until interrupted, keeping the
+// engines of every rule it ran between requests
+int serve(const std::string &path, const EngineOptions &options) {
+    DenisServer server(path);
+    runningServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    std::signal(SIGPIPE, SIG_IGN);      // Clients may close a pipe passed as output
+    std::cout << "Serving on: " << path << std::endl;
+
+    std::map<std::string, std::unique_ptr<ChunkScheduler>> schedulers;
+    server.serve([&](const std::vector<ServiceJob *> &jobs) {
+        runServiceRound(jobs, options, schedulers);
+    });
+
+    runningServer = nullptr;
+    std::cout << "Server stopped" << std::endl;
+    return 0;
+}
+
+// Has a server encode or decode `src` into `dst`, passing it both files
+int connectAndRun(const std::string &socket, bool encoding, const std::string &src, const std::string &dst,
+                  const std::string &key, const EngineOptions &options) {
+    const int input = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (input < 0) {
+        throw std::runtime_error("[e] Error opening file for reading: " + src);
+    }
+    const int output = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (output < 0) {
+        close(input);
+        throw std::runtime_error("[e] Error opening file for writing: " + dst);
+    }
+
+    ServiceRequest request;
+    request.operation = encoding ? ServiceOperation::Encode : ServiceOperation::Decode;
+    std::strncpy(request.rule, options.rule.notation().c_str(), sizeof(request.rule) - 1);
+    std::strncpy(request.topology, options.rule.topologyName().c_str(), sizeof(request.topology) - 1);
+    std::strncpy(request.key, key.c_str(), sizeof(request.key) - 1);
+
+    ServiceReply reply;
+    try {
+        reply = DenisClient(socket).submit(request, input, output);
+    } catch (...) {
+        close(input);
+        close(output);
+        throw;
+    }
+    close(input);
+    close(output);
+    if (reply.status != 0) {
+        throw std::runtime_error(reply.message);
+    }
+
+    if (encoding) {
+        showKey(reply.key);
+        std::cout << "Encoding complete! File saved to: " << dst << std::endl;
+    } else {
+        std::cout << "Decoding complete! File saved to: " << dst << std::endl;
+    }
+    return 0;
+}
+
+// Prints what a DENIS file's header says about its contents, without running the automaton
+int inspect(const std::vector<uint8_t> &denis) {
+    DenisDecoder dec(3);
+    auto [header, encoded_bytes] = dec.Decode(denis);
+    const AutomatonRule rule = fromDenisAutomaton(header.automaton);
+
+    const std::size_t chunkBytes = (rule.secondOrder() ? 2 : 1) * BUFFER_SIZE / 8;
+    const std::size_t totalChunks = encoded_bytes.size() / chunkBytes;
+    const std::size_t padding = totalChunks > 0 ? std::min<std::size_t>(header.padding, BUFFER_SIZE / 8) : 0;
+
+    std::cout << "Version:      " << header.version << std::endl;
+    std::cout << "Type:         " << EXTENSION_MAP.at(header.type) << std::endl;
+    std::cout << "Rule:         " << rule.notation() << ", " << rule.topologyName() << " topology" << std::endl;
+    std::cout << "Chunks:       " << totalChunks << " of " << chunkBytes << " bytes" << std::endl;
+    std::cout << "Padding:      " << header.padding << " bytes" << std::endl;
+    std::cout << "Decoded size: " << totalChunks * BUFFER_SIZE / 8 - padding << " bytes" << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv) {
     argparse::ArgumentParser program("denis");
 
     auto &group = program.add_mutually_exclusive_group(true);
     group.add_argument("-e", "--encode").flag();
     group.add_argument("-d", "--decode").flag();
+    group.add_argument("-r", "--replay").flag()
+            .help("Export a recorded trace (input) as a .y4m video or a directory of PNG frames (output)");
+    group.add_argument("-i", "--inspect").flag()
+            .help("Print the header of a DENIS file or QR code (input) without decoding it; needs no output or key");
+    group.add_argument("--serve")
+            .help("Serve encode and decode requests on this Unix socket (e.g. /run/denis.sock) until interrupted, keeping the engines warm between them");
+
+    program.add_argument("--connect")
+            .help("Have the server listening on this Unix socket encode or decode the input, instead of running the engines here");
 
     program.add_argument("--qr").flag()
             .help("Generate or read from a QR code");
 
+    program.add_argument("--pages").flag()
+            .help("With --qr, store the output as a directory of QR code pages");
+
+    program.add_argument("--pbm").flag()
+            .help("With --qr, write the page as a binary PBM image instead of PNG");
+
+    program.add_argument("--levels")
+            .default_value(2)
+            .scan<'i', int>()
+            .help("With --qr, grey levels per page module: 2, 4 or 8");
+
     program.add_argument("--visualize").flag()
             .help("Visualize the cellular automaton process");
 
+    program.add_argument("--visualize-every")
+            .default_value(0)
+            .scan<'i', int>()
+            .help("With --visualize, --record or --share, sample every Nth generation (0 = one per displayed frame)");
+
+    program.add_argument("--record")
+            .help("Record sampled generations to a trace file, for --replay");
+
+    program.add_argument("--share")
+            .help("Publish sampled generations to this POSIX shared memory name (e.g. /denis) for denis-view");
+
+    program.add_argument("--stats")
+            .help("Write each generation's live cell count and Hamming distance to the previous one to a CSV file");
+
+    program.add_argument("--rule")
+            .default_value(std::string("B3/S23"))
+            .help("Automaton rule in B/S notation, or the Margolus block rule critters or tron (output half the size); recorded in the encoded file");
+
+    program.add_argument("--topology")
+            .default_value(std::string("dead"))
+            .help("Grid edges when encoding: dead (dead border) or torus (wrap around)");
+
+    program.add_argument("--engine")
+            .default_value(std::string("gpu"))
+            .help("Engine running the automaton: gpu, cpu (bit-sliced), cpu-lut (lookup tables), cpu-tiled (bit-sliced with temporal blocking) or hybrid (GPU and CPU workers sharing the chunks)");
+
+    program.add_argument("--threads")
+            .default_value(1)
+            .scan<'i', int>()
+            .help("With a CPU engine, threads sharing the rows of each generation (0 = all cores); with hybrid, CPU workers beside the GPU (0 = all cores but one)");
+
+    program.add_argument("--gpu-streams")
+            .default_value(1)
+            .scan<'i', int>()
+            .help("With hybrid, GPU engines submitting chunks at once, each on its own thread and EGL context (0 = CPU only)");
+
+    program.add_argument("--batch")
+            .help("Encode or decode every file of this list into --outdir on one set of engines: one path per line, or for decoding a DENIS file and its key separated by a tab (as in the manifest.tsv encoding writes)");
+
+    program.add_argument("--outdir")
+            .help("With --batch, directory receiving the outputs and, when encoding, manifest.tsv with each file's key");
+
     program.add_argument("input")
-            .required()
-            .help("Input file path");
+            .default_value(std::string())
+            .help("Input file path (not used by --batch)");
 
     program.add_argument("output")
-            .required()
-            .help("Output file path");
+            .default_value(std::string())
+            .help("Output file path (not used by --inspect or --batch)");
 
     program.add_argument("--key")
             .help("Decryption key (required for decoding)");
@@ -275,35 +1047,171 @@ int main(int argc, char **argv) {
 
         bool is_encode = program.get<bool>("-e");
         bool qr = program.get<bool>("--qr");
+        bool pages = program.get<bool>("--pages");
+        bool pbm = program.get<bool>("--pbm");
+        int levels = program.get<int>("--levels");
         bool visualize = program.get<bool>("--visualize");
 
+        ObserveOptions observe;
+        observe.visualize = visualize;
+        observe.sampleEvery = program.get<int>("--visualize-every");
+        if (program.present("--record")) {
+            observe.recordPath = program.get<std::string>("--record");
+        }
+        if (program.present("--share")) {
+            observe.shareName = program.get<std::string>("--share");
+        }
+        if (program.present("--stats")) {
+            observe.statsPath = program.get<std::string>("--stats");
+        }
+
+        EngineOptions options;
+        options.engine = program.get<std::string>("--engine");
+        options.threads = program.get<int>("--threads");
+        options.gpuStreams = program.get<int>("--gpu-streams");
+        options.rule = AutomatonRule::parse(program.get<std::string>("--rule"),
+                                            AutomatonRule::parseTopology(program.get<std::string>("--topology")));
+
+        // Hybrid runs finish chunks out of order, with no single engine to watch
+        if (options.engine == "hybrid" && (visualize || !observe.recordPath.empty() || !observe.shareName.empty() ||
+                                           !observe.statsPath.empty())) {
+            throw std::invalid_argument("[e] The hybrid engine cannot be combined with --visualize, --record, --share or --stats");
+        }
+        if (options.threads < 0) {
+            throw std::invalid_argument("[e] Invalid thread count: " + std::to_string(options.threads));
+        }
+        if (options.gpuStreams < 0) {
+            throw std::invalid_argument("[e] Invalid GPU stream count: " + std::to_string(options.gpuStreams));
+        }
+
         auto input = program.get<std::string>("input");
         auto output = program.get<std::string>("output");
+        const bool inspecting = program.get<bool>("--inspect");
+
+        // Batches and the server run every file on the chunk scheduler, the CPU engines meaning no GPU stream
+        if (program.present("--batch") || program.present("--serve")) {
+            if (options.engine == "cpu" || options.engine == "cpu-lut") {
+                options.gpuStreams = 0;
+            } else if (options.engine != "gpu" && options.engine != "hybrid") {
+                throw std::invalid_argument("[e] Unknown engine: " + options.engine +
+                                            ". Expected gpu, cpu, cpu-lut or hybrid");
+            }
+        }
+
+        if (program.present("--serve")) {
+            int ret = serve(program.get<std::string>("--serve"), options);
+            EGLManager::cleanup();
+            return ret;
+        }
+
+        if (program.present("--batch")) {
+            if (!is_encode && !program.get<bool>("-d")) {
+                throw std::invalid_argument("[e] --batch only encodes or decodes");
+            }
+            if (qr || visualize || !observe.recordPath.empty() || !observe.shareName.empty() ||
+                !observe.statsPath.empty() || program.present("--connect")) {
+                throw std::invalid_argument("[e] --batch cannot be combined with --qr, --visualize, --record, --share, --stats or --connect");
+            }
+            if (!input.empty()) {
+                throw std::invalid_argument("[e] --batch takes its input files from the list, not as arguments");
+            }
+            if (!program.present("--outdir")) {
+                throw std::runtime_error("Missing required argument: --outdir (needed with --batch)");
+            }
+
+            const auto list = program.get<std::string>("--batch");
+            const auto outdir = program.get<std::string>("--outdir");
+            int ret = is_encode ? encodeBatch(list, outdir, options) : decodeBatch(list, outdir, options);
+            EGLManager::cleanup();
+            return ret;
+        }
+
+        if (input.empty()) {
+            throw std::runtime_error("Missing required argument: input");
+        }
+        if (output.empty() && !inspecting) {
+            throw std::runtime_error("Missing required argument: output");
+        }
+
+        // The server runs the engines, on the files passed to it
+        if (program.present("--connect")) {
+            if (!is_encode && !program.get<bool>("-d")) {
+                throw std::invalid_argument("[e] --connect only encodes or decodes");
+            }
+            if (qr || visualize || !observe.recordPath.empty() || !observe.shareName.empty() ||
+                !observe.statsPath.empty()) {
+                throw std::invalid_argument("[e] --connect cannot be combined with --qr, --visualize, --record, --share or --stats");
+            }
+            if (!is_encode && !program.present("--key")) {
+                throw std::runtime_error("Missing required argument: --key (needed for decoding)");
+            }
+            const std::string key = is_encode ? std::string() : program.get<std::string>("--key");
+            return connectAndRun(program.get<std::string>("--connect"), is_encode, input, output, key, options);
+        }
+
+        if (program.get<bool>("--replay")) {
+            // Export the frames, then play the trace in a window if requested
+            TraceReader trace(input);
+            if (std::filesystem::path(output).extension() == ".y4m")
+                trace.exportY4M(output);
+            else
+                trace.exportPNG(output);
+            std::cout << "Trace exported to: " << output << std::endl;
+
+            if (visualize) {
+                TraceReader replayed(input);
+                CellularAutomatonVisualizer visualizer("Denis Trace Replay");
+                visualizer.replay(replayed);
+            }
+
+            EGLManager::cleanup();
+            return 0;
+        }
 
         if (is_encode) {
-            int ret = encode(input, output, visualize);
+            std::vector<uint8_t> denis;
+            int ret = encode(input, output, denis, options, observe);
 
-            if (qr)
-                PhysicalStorage::QRCodeStorage::fileToQR(output, output + ".png");
+            bool stored = true;
+            if (ret == 0 && qr && pages)
+                stored = PhysicalStorage::QRCodeStorage::bytesToQRPages(denis, output + ".pages");
+            else if (ret == 0 && qr)
+                stored = PhysicalStorage::QRCodeStorage::bytesToQR(denis, output + (pbm ? ".pbm" : ".png"), levels);
+            if (!stored) {
+                std::cerr << "Error: [e] Error writing the QR code of: " << output << std::endl;
+                ret = 1;
+            }
 
             EGLManager::cleanup();
             return ret;
         }
 
-        if (!program.present("--key")) {
+        if (!inspecting && !program.present("--key")) {
             throw std::runtime_error(
                 "Missing required argument: --key (needed for decoding)");
         }
 
-        auto temp_dest = output + ".data";
+        std::vector<uint8_t> denis;
 
         if (qr) {
             std::cout << "Reading QR code..." << std::endl;
-            PhysicalStorage::QRCodeStorage::QRToFile(input, temp_dest);
+            denis = std::filesystem::is_directory(input)
+                        ? PhysicalStorage::QRCodeStorage::QRPagesToBytes(input)
+                        : PhysicalStorage::QRCodeStorage::QRToBytes(input);
+            if (denis.empty()) {
+                throw std::runtime_error("Failed to read QR code from: " + input);
+            }
+        } else {
+            denis = FileManagementHelper::ReadBuffer(input);
+        }
+
+        // Only the header is read: EGL is never initialised
+        if (inspecting) {
+            return inspect(denis);
         }
 
         auto key = program.get<std::string>("--key");
-        int ret = decode(qr ? temp_dest : input, output, Key(key), visualize);
+        int ret = decode(denis, output, Key(key), options, observe);
         EGLManager::cleanup();
         return ret;
     } catch (const std::exception &e) {
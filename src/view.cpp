@@ -0,0 +1,62 @@
+#include "CellularAutomatonVisualizer.hpp"
+#include "SharedSnapshotRing.h"
+
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+// denis-view: watches an encode or decode started with --share NAME. It attaches
+// to the run's shared memory ring and keeps retrying while no run is publishing,
+// so it can be started before, during or between runs
+int main(int argc, char **argv) {
+    argparse::ArgumentParser program("denis-view");
+
+    program.add_argument("name")
+            .default_value(std::string("/denis"))
+            .help("Shared memory name given to --share");
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << program;
+        return 1;
+    }
+
+    const auto name = program.get<std::string>("name");
+    const auto framePeriod = std::chrono::microseconds(1000000 / 60);
+    const auto retryPeriod = std::chrono::milliseconds(500);
+
+    CellularAutomatonVisualizer visualizer(("Denis Viewer - " + name).c_str());
+    visualizer.start();
+
+    std::unique_ptr<SharedSnapshotViewer> viewer;
+    auto nextAttempt = std::chrono::steady_clock::now();
+    GridSnapshot snapshot;
+
+    while (visualizer.isRunning()) {
+        // (Re)attach when no run is publishing
+        if (viewer && !viewer->publisherAlive()) {
+            viewer.reset();
+        }
+        if (!viewer && std::chrono::steady_clock::now() >= nextAttempt) {
+            try {
+                viewer = std::make_unique<SharedSnapshotViewer>(name);
+            } catch (const std::exception &) {
+                nextAttempt = std::chrono::steady_clock::now() + retryPeriod;
+            }
+        }
+
+        if (viewer && viewer->latest(snapshot)) {
+            visualizer.updateGridState(snapshot.currentGrid, snapshot.prevGrid, snapshot.chunkIndex,
+                                       snapshot.totalChunks, snapshot.iteration, snapshot.totalIterations);
+        }
+
+        std::this_thread::sleep_for(framePeriod);
+    }
+
+    visualizer.stop();
+    return 0;
+}